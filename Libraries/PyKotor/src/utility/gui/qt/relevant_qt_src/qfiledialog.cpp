@@ -28,6 +28,7 @@
 #include <qsettings.h>
 #endif
 #include <qdebug.h>
+#include <qscopedvaluerollback.h>
 #if QT_CONFIG(mimetype)
 #include <qmimedatabase.h>
 #endif
@@ -2994,7 +2995,13 @@ void QFileDialogPrivate::createWidgets()
                             this, &QFileDialogPrivate::pathChanged);
     QObjectPrivate::connect(model, &QFileSystemModel::rowsInserted,
                             this, &QFileDialogPrivate::rowsInserted);
+    QObjectPrivate::connect(model, &QFileSystemModel::fileOperationStarted,
+                            this, &QFileDialogPrivate::fileOperationStarted);
+    QObjectPrivate::connect(model, &QFileSystemModel::fileOperationFinished,
+                            this, &QFileDialogPrivate::fileOperationFinished);
     model->setReadOnly(false);
+    // only deletions run in the background, drops keep their semantics
+    model->d_func()->asynchronousRemove = true;
 
     qFileDialogUi.reset(new Ui_QFileDialog());
     qFileDialogUi->setupUi(q);
@@ -3569,6 +3576,8 @@ void QFileDialogPrivate::renameCurrent()
 bool QFileDialogPrivate::removeDirectory(const QString &path)
 {
     QModelIndex modelIndex = model->index(path);
+    // the directory may be deleted in the background, see fileOperationFinished()
+    const QScopedValueRollback<bool> rollback(removingDirectory, true);
     return model->remove(modelIndex);
 }
 
@@ -3642,8 +3651,8 @@ void QFileDialogPrivate::autoCompleteFileName(const QString &text)
     if (multipleFiles.size() > 0) {
         QModelIndexList oldFiles = qFileDialogUi->listView->selectionModel()->selectedRows();
         QList<QModelIndex> newFiles;
-        for (const auto &file : multipleFiles) {
-            QModelIndex idx = model->index(file);
+        const QModelIndexList indexes = model->indexes(multipleFiles);
+        for (const auto &idx : indexes) {
             if (oldFiles.removeAll(idx) == 0)
                 newFiles.append(idx);
         }
@@ -3729,11 +3738,12 @@ void QFileDialogPrivate::updateOkButton()
             break;
         }
         case QFileDialog::ExistingFile:
-        case QFileDialog::ExistingFiles:
-            for (const auto &file : files) {
-                QModelIndex idx = model->index(file);
+        case QFileDialog::ExistingFiles: {
+            const QModelIndexList indexes = model->indexes(files);
+            for (qsizetype i = 0; i < files.size(); ++i) {
+                QModelIndex idx = indexes.at(i);
                 if (!idx.isValid())
-                    idx = model->index(getEnvironmentVariable(file));
+                    idx = model->index(getEnvironmentVariable(files.at(i)));
                 if (!idx.isValid()) {
                     enableButton = false;
                     break;
@@ -3744,6 +3754,7 @@ void QFileDialogPrivate::updateOkButton()
                 }
             }
             break;
+        }
         default:
             break;
         }
@@ -3938,6 +3949,22 @@ void QFileDialogPrivate::fileRenamed(const QString &path, const QString &oldName
     }
 }
 
+void QFileDialogPrivate::fileOperationStarted(int operation)
+{
+    if (removingDirectory)
+        directoryRemovals.insert(operation);
+}
+
+void QFileDialogPrivate::fileOperationFinished(int operation, bool success)
+{
+    if (!directoryRemovals.remove(operation) || success)
+        return;
+#if QT_CONFIG(messagebox)
+    Q_Q(QFileDialog);
+    QMessageBox::warning(q, q->windowTitle(), QFileDialog::tr("Could not delete directory."));
+#endif
+}
+
 void QFileDialogPrivate::emitUrlSelected(const QUrl &file)
 {
     Q_Q(QFileDialog);
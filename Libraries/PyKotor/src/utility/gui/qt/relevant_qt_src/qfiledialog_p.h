@@ -191,6 +191,8 @@ public:
     void autoCompleteFileName(const QString &);
     void rowsInserted(const QModelIndex & parent);
     void fileRenamed(const QString &path, const QString &oldName, const QString &newName);
+    void fileOperationStarted(int operation);
+    void fileOperationFinished(int operation, bool success);
 
     // layout
 #if QT_CONFIG(proxymodel)
@@ -200,6 +202,9 @@ public:
     // data
     QStringList watching;
     QFileSystemModel *model;
+    // Directories being deleted in the background, by file operation
+    QSet<int> directoryRemovals;
+    bool removingDirectory = false;
 
 #if QT_CONFIG(fscompleter)
     QFSCompleter *completer;
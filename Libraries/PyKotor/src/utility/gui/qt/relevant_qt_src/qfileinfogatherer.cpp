@@ -321,6 +321,32 @@ void QFileInfoGatherer::list(const QString &directoryPath)
     fetchExtendedInformation(directoryPath, QStringList());
 }
 
+/*
+    Compute the total size and number of items below \a path, and of each
+    directory below it. The results are reported by directorySizes(); listing
+    files always takes precedence.
+
+    \sa cancelDirectorySizes()
+*/
+void QFileInfoGatherer::computeDirectorySize(const QString &path)
+{
+    QMutexLocker locker(&mutex);
+    if (sizePaths.contains(path))
+        return;
+    sizePaths.append(path);
+    condition.wakeAll();
+}
+
+/*
+    Drop all pending and running directory size computations
+*/
+void QFileInfoGatherer::cancelDirectorySizes()
+{
+    QMutexLocker locker(&mutex);
+    sizePaths.clear();
+    ++sizeGeneration;
+}
+
 /*
     Until aborted wait to fetch a directory or files
 */
@@ -331,10 +357,26 @@ void QFileInfoGatherer::run()
         // woken up cleanly.
         setTerminationEnabled(false);
         QMutexLocker locker(&mutex);
-        while (!isInterruptionRequested() && path.isEmpty())
+        while (!isInterruptionRequested() && path.isEmpty()
+               && sizePaths.isEmpty() && sizeScan.isEmpty()) {
             condition.wait(&mutex);
+        }
         if (isInterruptionRequested())
             return;
+        if (path.isEmpty()) {
+            // Nothing to list, continue with the directory sizes
+            if (sizeScanGeneration != sizeGeneration) {
+                sizeScan.clear();
+                sizeResults.clear();
+                sizeScanGeneration = sizeGeneration;
+            }
+            if (sizeScan.isEmpty() && !sizePaths.isEmpty())
+                sizeScan.append(SizeFrame{ sizePaths.takeFirst() });
+            locker.unlock();
+            setTerminationEnabled(true);
+            computeDirectorySizes();
+            continue;
+        }
         const QString thisPath = std::as_const(path).front();
         path.pop_front();
         const QStringList thisList = std::as_const(files).front();
@@ -349,15 +391,27 @@ void QFileInfoGatherer::run()
     }
 }
 
-QExtendedInformation QFileInfoGatherer::getInfo(const QFileInfo &fileInfo) const
+/*!
+    \internal
+
+    Sets the icon and the display type of \a info from the current icon provider.
+*/
+void QFileInfoGatherer::resolveDecoration(QExtendedInformation &info) const
 {
-    QExtendedInformation info(fileInfo);
+    const QFileInfo fileInfo = info.fileInfo();
     if (m_iconProvider) {
         info.icon = m_iconProvider->icon(fileInfo);
         info.displayType = m_iconProvider->type(fileInfo);
     } else {
+        info.icon = QIcon();
         info.displayType = QAbstractFileIconProviderPrivate::getFileType(fileInfo);
     }
+}
+
+QExtendedInformation QFileInfoGatherer::getInfo(const QFileInfo &fileInfo) const
+{
+    QExtendedInformation info(fileInfo);
+    resolveDecoration(info);
 #if QT_CONFIG(filesystemwatcher)
     // ### Not ready to listen all modifications by default
     static const bool watchFiles = qEnvironmentVariableIsSet("QT_FILESYSTEMMODEL_WATCH_FILES");
@@ -452,9 +506,75 @@ void QFileInfoGatherer::getFileInfos(const QString &path, const QStringList &fil
     }
     if (!updatedFiles.isEmpty())
         emit updates(path, updatedFiles);
+    // directoryLoaded() is also emitted for the requests of a few files
+    if (files.isEmpty() && !isInterruptionRequested())
+        emit directoryListed(path);
     emit directoryLoaded(path);
 }
 
+/*
+    Returns \c true if the directory size computation must give way, either
+    because files have to be listed or because it was cancelled.
+*/
+bool QFileInfoGatherer::mustSuspendSizeScan()
+{
+    QMutexLocker locker(&mutex);
+    return isInterruptionRequested() || !path.isEmpty() || sizeScanGeneration != sizeGeneration;
+}
+
+/*
+    Continue the directory size computation in sizeScan, one directory at a
+    time, until it is done or must be suspended. Symbolic links are counted
+    but not followed.
+*/
+void QFileInfoGatherer::computeDirectorySizes()
+{
+    if (sizeScan.isEmpty())
+        return;
+    const QString root = sizeScan.constFirst().path;
+    QElapsedTimer base;
+    base.start();
+    while (!sizeScan.isEmpty()) {
+        if (mustSuspendSizeScan())
+            return;
+
+        SizeFrame &frame = sizeScan.last();
+        if (!frame.listed) {
+            using F = QDirListing::IteratorFlag;
+            for (const auto &dirEntry : QDirListing(frame.path, F::IncludeHidden | F::IncludeBrokenSymlinks)) {
+                ++frame.items;
+                if (dirEntry.isSymLink())
+                    continue;
+                if (dirEntry.isDir())
+                    frame.subdirectories.append(dirEntry.filePath());
+                else
+                    frame.size += dirEntry.size();
+            }
+            frame.listed = true;
+        }
+        if (!frame.subdirectories.isEmpty()) {
+            QString subdirectory = frame.subdirectories.takeLast();
+            sizeScan.append(SizeFrame{ std::move(subdirectory) });
+            continue;
+        }
+
+        const SizeFrame done = sizeScan.takeLast();
+        if (!sizeScan.isEmpty()) {
+            sizeScan.last().size += done.size;
+            sizeScan.last().items += done.items;
+        }
+        const QString relativePath = done.path.size() > root.size()
+                ? done.path.sliced(root.size() + 1) : QString();
+        sizeResults.append(QDirectorySize{ relativePath, done.size, done.items });
+        if (sizeResults.size() > 100 || base.elapsed() > 1000) {
+            emit directorySizes(root, std::exchange(sizeResults, {}));
+            base.restart();
+        }
+    }
+    if (!sizeResults.isEmpty())
+        emit directorySizes(root, std::exchange(sizeResults, {}));
+}
+
 void QFileInfoGatherer::fetch(const QFileInfo &fileInfo, QElapsedTimer &base, bool &firstTime,
                               QList<std::pair<QString, QFileInfo>> &updatedFiles, const QString &path)
 {
@@ -121,6 +121,15 @@ private :
     QFileInfo mFileInfo;
 };
 
+// Recursive size of a directory, computed by QFileInfoGatherer::computeDirectorySize()
+struct QDirectorySize
+{
+    QString path; // relative to the directory the computation was requested for
+    qint64 size = 0;
+    qint64 items = 0;
+};
+Q_DECLARE_TYPEINFO(QDirectorySize, Q_RELOCATABLE_TYPE);
+
 class QFileIconProvider;
 
 class Q_GUI_EXPORT QFileInfoGatherer : public QThread
@@ -132,6 +141,9 @@ Q_SIGNALS:
     void newListOfFiles(const QString &directory, const QStringList &listOfFiles) const;
     void nameResolved(const QString &fileName, const QString &resolvedName) const;
     void directoryLoaded(const QString &path);
+    // only emitted once all the files of the directory have been listed
+    void directoryListed(const QString &path);
+    void directorySizes(const QString &directory, const QList<QDirectorySize> &sizes);
 
 public:
     explicit QFileInfoGatherer(QObject *parent = nullptr);
@@ -149,11 +161,16 @@ public:
     void clear();
     void removePath(const QString &path);
     QExtendedInformation getInfo(const QFileInfo &info) const;
+    void resolveDecoration(QExtendedInformation &info) const;
     QAbstractFileIconProvider *iconProvider() const;
     bool resolveSymlinks() const;
 
     void requestAbort();
 
+    // thread-safe:
+    void computeDirectorySize(const QString &path);
+    void cancelDirectorySizes();
+
 public Q_SLOTS:
     void list(const QString &directoryPath);
     void fetchExtendedInformation(const QString &path, const QStringList &files);
@@ -174,6 +191,8 @@ private:
     void getFileInfos(const QString &path, const QStringList &files);
     void fetch(const QFileInfo &info, QElapsedTimer &base, bool &firstTime,
                QList<std::pair<QString, QFileInfo>> &updatedFiles, const QString &path);
+    void computeDirectorySizes();
+    bool mustSuspendSizeScan();
 
 private:
     void createWatcher();
@@ -183,8 +202,25 @@ private:
     QWaitCondition condition;
     QStack<QString> path;
     QStack<QStringList> files;
+    QStringList sizePaths;
+    uint sizeGeneration = 0;
     // end protected by mutex
 
+    // Directory size computation in progress, only accessed by run(). It
+    // holds one frame per directory from the requested one to the one
+    // being scanned, so that it can be suspended while files are listed.
+    struct SizeFrame
+    {
+        QString path;
+        qint64 size = 0;
+        qint64 items = 0;
+        QStringList subdirectories;
+        bool listed = false;
+    };
+    QList<SizeFrame> sizeScan;
+    QList<QDirectorySize> sizeResults;
+    uint sizeScanGeneration = 0;
+
 #if QT_CONFIG(filesystemwatcher)
     QFileSystemWatcher *m_watcher = nullptr;
 #endif
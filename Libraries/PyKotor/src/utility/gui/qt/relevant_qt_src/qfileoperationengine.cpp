@@ -0,0 +1,537 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+// Qt-Security score:significant reason:default
+
+#include "qfileoperationengine_p.h"
+#include <qdir.h>
+#include <qdirlisting.h>
+#include <qfile.h>
+#include <qfileinfo.h>
+#include <qsemaphore.h>
+#include <qthread.h>
+#include <QtCore/private/qglobal_p.h>
+#include <QtCore/private/qfilesystemengine_p.h>
+#include <QtCore/private/qsystemerror_p.h>
+
+#include <utility>
+
+#include <errno.h>
+#if defined(Q_OS_WIN)
+#  include <QtCore/qt_windows.h>
+#endif
+#if defined(Q_OS_LINUX)
+#  include <unistd.h>
+#  include <sys/ioctl.h>
+#  include <linux/fs.h>
+#endif
+#if defined(Q_OS_DARWIN)
+#  include <sys/clonefile.h>
+#endif
+
+QT_BEGIN_NAMESPACE
+
+// Amount of data copied between two checks for cancellation
+static constexpr qint64 CopyChunkSize = 16 * 1024 * 1024;
+static constexpr qint64 BufferSize = 1024 * 1024;
+// Number of files of a directory removed between two updates of the model
+static constexpr qsizetype RemoveBatchSize = 512;
+
+static bool removeFile(const QString &path)
+{
+    if (QFile::remove(path))
+        return true;
+#ifdef Q_OS_WIN
+    // read-only files can't be removed, same as QDir::removeRecursively()
+    if (QFile::setPermissions(path, QFile::ReadOwner | QFile::WriteOwner))
+        return QFile::remove(path);
+#endif
+    return false;
+}
+
+// The targets of the items are never overwritten. This only saves starting
+// an item whose target is already there: the items still create their
+// targets exclusively, and fail without touching what was created meanwhile.
+static bool targetExists(const QString &target)
+{
+    const QFileInfo info(target);
+    return info.exists() || info.isSymLink();
+}
+
+// Renaming fails across file systems, the item is copied instead then
+static bool isCrossDeviceError(const QSystemError &error)
+{
+#ifdef Q_OS_WIN
+    return error.errorCode == ERROR_NOT_SAME_DEVICE;
+#else
+    return error.errorCode == EXDEV;
+#endif
+}
+
+/*!
+    \class QFileOperationEngine
+    \inmodule QtGui
+    \internal
+
+    Copies, moves, links and removes files on a pool of worker threads, for
+    the drops and QFileSystemModel::remove(). Each item of an operation is
+    processed by a worker of its own. progress() reports the number of bytes
+    processed so far, and the operation can be canceled at any time; the items
+    that were not completely copied then leave nothing behind in the
+    destination, while removals leave what they did not reach yet.
+*/
+
+QFileOperationEngine::QFileOperationEngine(QObject *parent)
+    : QObject(parent)
+{
+    // the items are bound by the disks rather than by the processors
+    pool.setMaxThreadCount(qBound(2, QThread::idealThreadCount(), 4));
+}
+
+/*!
+    Cancels the operations that are still running and waits for the workers.
+*/
+QFileOperationEngine::~QFileOperationEngine()
+{
+    for (const OperationPointer &op : std::as_const(operations))
+        op->canceled = true;
+    pool.waitForDone();
+}
+
+/*!
+    Starts to apply \a kind to each of \a sources, with the items of the
+    same name in the directory \a destination as targets, and returns
+    the id of the operation. Removals have no \a destination.
+*/
+int QFileOperationEngine::start(Kind kind, const QStringList &sources, const QString &destination)
+{
+    auto op = std::make_shared<Operation>();
+    op->id = nextId++;
+    op->kind = kind;
+    op->sources = sources;
+    op->destination = destination;
+    operations.insert(op->id, op);
+    pool.start([this, op] { run(op); });
+    return op->id;
+}
+
+/*!
+    Returns \c true if \a path is \a directory or lies below it, following
+    symbolic links. Copying or moving \a directory into \a path would
+    never end.
+*/
+bool QFileOperationEngine::isWithin(const QString &path, const QString &directory)
+{
+    if (path.isEmpty() || directory.isEmpty())
+        return false;
+    const auto resolved = [](const QString &p) {
+        const QFileInfo info(p);
+        const QString canonical = info.canonicalFilePath();
+        return canonical.isEmpty() ? QDir::cleanPath(info.absoluteFilePath()) : canonical;
+    };
+    const QString resolvedPath = resolved(path);
+    const QString resolvedDirectory = resolved(directory);
+#if defined(Q_OS_WIN) || defined(Q_OS_DARWIN)
+    constexpr Qt::CaseSensitivity cs = Qt::CaseInsensitive;
+#else
+    constexpr Qt::CaseSensitivity cs = Qt::CaseSensitive;
+#endif
+    if (!resolvedPath.startsWith(resolvedDirectory, cs))
+        return false;
+    return resolvedPath.size() == resolvedDirectory.size()
+            || resolvedDirectory.endsWith(u'/')
+            || resolvedPath.at(resolvedDirectory.size()) == u'/';
+}
+
+/*!
+    Cancels \a operation. It still emits finished(), once its workers stopped.
+*/
+void QFileOperationEngine::cancel(int operation)
+{
+    if (const OperationPointer op = operations.value(operation))
+        op->canceled = true;
+}
+
+/*!
+    \internal
+
+    Computes the total size of the operation, then starts a worker for each
+    item. A deletion only lists its tree once: removeTree() adds the sizes of
+    the files it is about to remove to the total.
+*/
+void QFileOperationEngine::run(const OperationPointer &op)
+{
+    op->sizes.reserve(op->sources.size());
+    qint64 total = 0;
+    for (const QString &source : std::as_const(op->sources)) {
+        const qint64 size = op->kind == Link || op->kind == Remove ? 0 : treeSize(source, *op);
+        op->sizes.append(size);
+        total += size;
+    }
+    op->bytesTotal = total;
+    addProgress(op, 0);
+
+    if (op->sources.isEmpty()) {
+        op->pendingItems = 1;
+        runItem(op, -1);
+        return;
+    }
+    op->pendingItems = int(op->sources.size());
+    for (qsizetype i = 1; i < op->sources.size(); ++i)
+        pool.start([this, op, i] { runItem(op, i); });
+    runItem(op, 0);
+}
+
+/*!
+    \internal
+
+    Processes the source at \a item, and emits finished() if it was the last
+    item of \a op.
+*/
+void QFileOperationEngine::runItem(const OperationPointer &op, qsizetype item)
+{
+    if (item >= 0) {
+        const QString source = op->sources.at(item);
+        QString target;
+        if (op->kind != Remove) {
+            target = op->destination;
+            if (!target.endsWith(u'/'))
+                target.append(u'/');
+            target.append(QFileInfo(source).fileName());
+        }
+
+        bool success = false;
+        const bool intoItself = (op->kind == Copy || op->kind == Move)
+                && isWithin(op->destination, source);
+        if (!op->canceled && !intoItself && (op->kind == Remove || !targetExists(target))) {
+            switch (op->kind) {
+            case Copy:
+                success = copyTree(source, target, op);
+                break;
+            case Move:
+                success = moveItem(source, target, op->sizes.at(item), op);
+                break;
+            case Link:
+                success = QFile::link(source, target);
+                break;
+            case Remove:
+                success = removeTree(source, op);
+                break;
+            }
+        }
+        if (!success)
+            op->failed = true;
+        QMetaObject::invokeMethod(this, [this, id = op->id, source, target, success] {
+            emit itemFinished(id, source, target, success);
+        }, Qt::QueuedConnection);
+    }
+
+    if (--op->pendingItems == 0) {
+        QMetaObject::invokeMethod(this, [this, op] {
+            operations.remove(op->id);
+            emit finished(op->id, !op->failed && !op->canceled);
+        }, Qt::QueuedConnection);
+    }
+}
+
+/*!
+    \internal
+
+    Returns the number of bytes in the files at and below \a path. Symbolic
+    links below \a path are not followed.
+*/
+qint64 QFileOperationEngine::treeSize(const QString &path, const Operation &op) const
+{
+    const QFileInfo info(path);
+    if (!info.isDir() || info.isSymLink())
+        return info.isFile() ? info.size() : 0;
+    qint64 size = 0;
+    using F = QDirListing::IteratorFlag;
+    constexpr auto flags = F::Recursive | F::IncludeHidden | F::IncludeBrokenSymlinks;
+    for (const auto &dirEntry : QDirListing(path, flags)) {
+        if (op.canceled)
+            break;
+        if (!dirEntry.isSymLink() && !dirEntry.isDir())
+            size += dirEntry.size();
+    }
+    return size;
+}
+
+/*!
+    \internal
+
+    Copies the file or the directory \a source to \a target, which must not
+    exist. Symbolic links inside a directory are copied as links. If the copy
+    fails, what it created is removed, and only that: an existing \a target
+    is left alone.
+*/
+bool QFileOperationEngine::copyTree(const QString &source, const QString &target,
+                                    const OperationPointer &op)
+{
+    const QFileInfo info(source);
+    if (!info.isDir() || info.isSymLink())
+        return copyFile(source, target, op);
+    // fails if the target exists, so the directory is ours to remove
+    if (!QDir().mkdir(target))
+        return false;
+
+    bool success = true;
+    using F = QDirListing::IteratorFlag;
+    for (const auto &dirEntry : QDirListing(source, F::IncludeHidden | F::IncludeBrokenSymlinks)) {
+        if (op->canceled)
+            break;
+        const QString entryTarget = target + u'/' + dirEntry.fileName();
+        if (dirEntry.isSymLink())
+            success = QFile::link(dirEntry.fileInfo().symLinkTarget(), entryTarget);
+        else if (dirEntry.isDir())
+            success = copyTree(dirEntry.filePath(), entryTarget, op);
+        else
+            success = copyFile(dirEntry.filePath(), entryTarget, op);
+        if (!success)
+            break;
+    }
+    if (!success || op->canceled) {
+        QDir(target).removeRecursively();
+        return false;
+    }
+    return true;
+}
+
+/*!
+    \internal
+
+    Copies the contents and the permissions of the file \a source to
+    \a target, which must not exist. A partial copy is removed.
+*/
+bool QFileOperationEngine::copyFile(const QString &source, const QString &target,
+                                    const OperationPointer &op)
+{
+    QFile in(source);
+    if (!in.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+        return false;
+#if defined(Q_OS_DARWIN)
+    // shares the blocks of the file on APFS
+    if (::clonefile(QFile::encodeName(source).constData(),
+                    QFile::encodeName(target).constData(), 0) == 0) {
+        addProgress(op, in.size());
+        return true;
+    }
+#endif
+    QFile out(target);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::NewOnly | QIODevice::Unbuffered))
+        return false;
+    bool success = copyData(in, out, op);
+    if (success)
+        success = out.setPermissions(in.permissions());
+    out.close();
+    if (!success)
+        out.remove();
+    return success;
+}
+
+/*!
+    \internal
+
+    Copies the contents of \a in to \a out. Where possible the file system
+    shares the blocks of the file, or the kernel copies them, so that the data
+    never has to go through this process.
+*/
+bool QFileOperationEngine::copyData(QFile &in, QFile &out, const OperationPointer &op)
+{
+#if defined(Q_OS_LINUX)
+    const int inFd = in.handle();
+    const int outFd = out.handle();
+#  ifdef FICLONE
+    // reflink on Btrfs, XFS and others
+    if (::ioctl(outFd, FICLONE, inFd) == 0) {
+        addProgress(op, in.size());
+        return true;
+    }
+#  endif
+#  if QT_CONFIG(copy_file_range)
+    bool copied = false;
+    for (;;) {
+        if (op->canceled)
+            return false;
+        const ssize_t n = ::copy_file_range(inFd, nullptr, outFd, nullptr, CopyChunkSize, 0);
+        if (n > 0) {
+            copied = true;
+            addProgress(op, n);
+            continue;
+        }
+        if (n == 0) {
+            // some file systems report no data at all instead of an error
+            if (copied || in.size() == 0)
+                return true;
+            break;
+        }
+        if (errno == EINTR)
+            continue;
+        // older kernels refuse to copy between file systems
+        if (copied || (errno != EXDEV && errno != EINVAL && errno != ENOSYS
+                       && errno != EOPNOTSUPP && errno != EPERM)) {
+            return false;
+        }
+        break;
+    }
+#  endif
+#endif
+
+    QByteArray buffer(BufferSize, Qt::Uninitialized);
+    for (;;) {
+        if (op->canceled)
+            return false;
+        const qint64 n = in.read(buffer.data(), buffer.size());
+        if (n < 0)
+            return false;
+        if (n == 0)
+            return true;
+        if (out.write(buffer.constData(), n) != n)
+            return false;
+        addProgress(op, n);
+    }
+}
+
+/*!
+    \internal
+
+    Renames \a source to \a target, or copies it and removes \a source if they
+    are on different file systems. \a size is the size of \a source, and
+    \a target must not exist; the rename never replaces it.
+*/
+bool QFileOperationEngine::moveItem(const QString &source, const QString &target, qint64 size,
+                                    const OperationPointer &op)
+{
+    QSystemError error;
+    if (QFileSystemEngine::renameFile(QFileSystemEntry(source), QFileSystemEntry(target), error)) {
+        addProgress(op, size);
+        return true;
+    }
+    // any other error, such as a permission error, fails the item
+    if (!isCrossDeviceError(error))
+        return false;
+
+    if (!copyTree(source, target, op))
+        return false;
+    const QFileInfo info(source);
+    return info.isDir() && !info.isSymLink() ? QDir(source).removeRecursively()
+                                             : QFile::remove(source);
+}
+
+/*!
+    \internal
+
+    Removes the file or the directory at \a path, and adds the size of the
+    files it removes to the total of \a op once it listed them. The files of
+    a directory are unlinked in batches, by as many workers of the pool as
+    are free, and entriesRemoved() is emitted for each batch. The directories
+    are removed last.
+*/
+bool QFileOperationEngine::removeTree(const QString &path, const OperationPointer &op)
+{
+    const QFileInfo info(path);
+    if (!info.isDir() || info.isSymLink()) {
+        const qint64 size = info.isFile() && !info.isSymLink() ? info.size() : 0;
+        op->bytesTotal += size;
+        if (!removeFile(path))
+            return false;
+        addProgress(op, size);
+        return true;
+    }
+
+    struct Batch {
+        QString directory;
+        QStringList names;
+        qint64 size = 0;
+    };
+    QStringList directories = { path }; // parents before their children
+    QList<Batch> batches;
+    qint64 size = 0;
+    using F = QDirListing::IteratorFlag;
+    constexpr auto flags = F::IncludeHidden | F::IncludeBrokenSymlinks;
+    for (qsizetype i = 0; i < directories.size(); ++i) {
+        if (op->canceled)
+            return false;
+        Batch batch = { directories.at(i), {}, 0 };
+        for (const auto &dirEntry : QDirListing(batch.directory, flags)) {
+            if (!dirEntry.isSymLink() && dirEntry.isDir()) {
+                directories.append(dirEntry.filePath());
+                continue;
+            }
+            batch.names.append(dirEntry.fileName());
+            if (!dirEntry.isSymLink())
+                batch.size += dirEntry.size();
+            if (batch.names.size() == RemoveBatchSize) {
+                const QString directory = batch.directory;
+                batches.append(std::exchange(batch, { directory, {}, 0 }));
+            }
+        }
+        if (!batch.names.isEmpty())
+            batches.append(std::move(batch));
+    }
+    for (const Batch &batch : std::as_const(batches))
+        size += batch.size;
+    op->bytesTotal += size;
+    addProgress(op, 0);
+
+    std::atomic<qsizetype> next = 0;
+    std::atomic<bool> failed = false;
+    const auto removeBatches = [&] {
+        for (qsizetype i = next++; i < batches.size() && !op->canceled; i = next++) {
+            const Batch &batch = batches.at(i);
+            QStringList removed;
+            removed.reserve(batch.names.size());
+            for (const QString &name : batch.names) {
+                if (removeFile(batch.directory + u'/' + name))
+                    removed.append(name);
+                else
+                    failed = true;
+            }
+            addProgress(op, batch.size);
+            if (!removed.isEmpty()) {
+                QMetaObject::invokeMethod(this, [this, id = op->id, directory = batch.directory,
+                                                 removed = std::move(removed)] {
+                    emit entriesRemoved(id, directory, removed);
+                }, Qt::QueuedConnection);
+            }
+        }
+    };
+    // Helpers are only started on workers that are free right away, so
+    // waiting for them can't keep the pool from making progress.
+    QSemaphore helpersDone;
+    int helpers = 0;
+    while (helpers + 1 < batches.size() && helpers + 1 < pool.maxThreadCount()
+           && pool.tryStart([&] { removeBatches(); helpersDone.release(); })) {
+        ++helpers;
+    }
+    removeBatches();
+    helpersDone.acquire(helpers);
+    if (failed || op->canceled)
+        return false;
+
+    for (auto it = directories.crbegin(), end = directories.crend(); it != end; ++it) {
+        if (!QDir().rmdir(*it))
+            return false;
+    }
+    return true;
+}
+
+/*!
+    \internal
+
+    Adds \a bytes to the progress of \a op. Updates are coalesced until the
+    thread of the engine emitted the previous one.
+*/
+void QFileOperationEngine::addProgress(const OperationPointer &op, qint64 bytes)
+{
+    op->bytesDone += bytes;
+    if (op->progressPending.exchange(true))
+        return;
+    QMetaObject::invokeMethod(this, [this, op] {
+        op->progressPending = false;
+        emit progress(op->id, op->bytesDone, op->bytesTotal);
+    }, Qt::QueuedConnection);
+}
+
+QT_END_NAMESPACE
+
+#include "moc_qfileoperationengine_p.cpp"
@@ -0,0 +1,94 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+// Qt-Security score:significant reason:default
+
+#ifndef QFILEOPERATIONENGINE_P_H
+#define QFILEOPERATIONENGINE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtGui/private/qtguiglobal_p.h>
+
+#include <qobject.h>
+#include <qhash.h>
+#include <qstringlist.h>
+#include <qthreadpool.h>
+
+#include <atomic>
+#include <memory>
+
+QT_REQUIRE_CONFIG(filesystemmodel);
+QT_REQUIRE_CONFIG(thread);
+
+QT_BEGIN_NAMESPACE
+
+class QFile;
+
+class Q_AUTOTEST_EXPORT QFileOperationEngine : public QObject
+{
+    Q_OBJECT
+
+Q_SIGNALS:
+    // all signals are emitted in the thread of the engine
+    void progress(int operation, qint64 bytesDone, qint64 bytesTotal);
+    void itemFinished(int operation, const QString &source, const QString &target, bool success);
+    void entriesRemoved(int operation, const QString &directory, const QStringList &names);
+    void finished(int operation, bool success);
+
+public:
+    enum Kind { Copy, Move, Link, Remove };
+
+    explicit QFileOperationEngine(QObject *parent = nullptr);
+    ~QFileOperationEngine();
+
+    int start(Kind kind, const QStringList &sources, const QString &destination);
+    void cancel(int operation);
+    bool isRunning(int operation) const { return operations.contains(operation); }
+
+    static bool isWithin(const QString &path, const QString &directory);
+
+private:
+    struct Operation {
+        int id = 0;
+        Kind kind = Copy;
+        QStringList sources;
+        QString destination;
+        QList<qint64> sizes; // of each source but removed ones, known before the items start
+        std::atomic<qint64> bytesTotal = 0;
+        std::atomic<qint64> bytesDone = 0;
+        std::atomic<int> pendingItems = 0;
+        std::atomic<bool> canceled = false;
+        std::atomic<bool> failed = false;
+        std::atomic<bool> progressPending = false;
+    };
+    using OperationPointer = std::shared_ptr<Operation>;
+
+    // run by the workers
+    void run(const OperationPointer &op);
+    void runItem(const OperationPointer &op, qsizetype item);
+    qint64 treeSize(const QString &path, const Operation &op) const;
+    bool copyTree(const QString &source, const QString &target, const OperationPointer &op);
+    bool copyFile(const QString &source, const QString &target, const OperationPointer &op);
+    bool copyData(QFile &in, QFile &out, const OperationPointer &op);
+    bool moveItem(const QString &source, const QString &target, qint64 size,
+                  const OperationPointer &op);
+    bool removeTree(const QString &path, const OperationPointer &op);
+    void addProgress(const OperationPointer &op, qint64 bytes);
+
+    QThreadPool pool;
+    QHash<int, OperationPointer> operations; // only accessed in the thread of the engine
+    int nextId = 1;
+};
+
+QT_END_NAMESPACE
+
+#endif // QFILEOPERATIONENGINE_P_H
@@ -10,14 +10,19 @@
 #include <qurl.h>
 #include <qdebug.h>
 #include <QtCore/qcollator.h>
+#if QT_CONFIG(temporaryfile)
+#  include <QtCore/qsavefile.h>
+#endif
+#include <QtCore/qvarlengtharray.h>
 #if QT_CONFIG(regularexpression)
 #  include <QtCore/qregularexpression.h>
 #endif
 
 #include <algorithm>
+#include <limits>
+#include <numeric>
 
 #ifdef Q_OS_WIN
-#  include <QtCore/QVarLengthArray>
 #  include <qt_windows.h>
 #  include <shlobj.h>
 #endif
@@ -156,6 +161,34 @@ QFileInfo QFileSystemModel::fileInfo(const QModelIndex &index) const
 
 */
 
+/*!
+    \since 6.10
+    \fn void QFileSystemModel::fileOperationStarted(int operation)
+
+    This signal is emitted by dropMimeData() and remove() when they started
+    the file \a operation in the background, see AsynchronousFileOperations.
+
+    \sa cancelFileOperation()
+*/
+
+/*!
+    \since 6.10
+    \fn void QFileSystemModel::fileOperationProgress(int operation, qint64 bytesDone, qint64 bytesTotal)
+
+    This signal is emitted while the file \a operation runs, with the number
+    of bytes that were copied, moved or deleted so far in \a bytesDone, out
+    of \a bytesTotal. Moves within a file system count the size of what they
+    moved at once.
+*/
+
+/*!
+    \since 6.10
+    \fn void QFileSystemModel::fileOperationFinished(int operation, bool success)
+
+    This signal is emitted when the file \a operation ended. \a success is
+    \c false if the operation was canceled or if any of its items failed.
+*/
+
 /*!
     \fn bool QFileSystemModel::remove(const QModelIndex &index)
 
@@ -163,6 +196,12 @@ QFileInfo QFileSystemModel::fileInfo(const QModelIndex &index) const
     corresponding file from the file system}, returning true if successful. If the
     item cannot be removed, false is returned.
 
+    If the AsynchronousFileOperations option is set, the file or directory is
+    deleted in the background, and this function returns \c true once that
+    started. fileOperationStarted() then gives the operation, whose outcome
+    is reported by fileOperationFinished(). The rows of the deleted files are
+    removed while the operation runs.
+
     \warning This function deletes files from the file system; it does \b{not}
     move them to a location where they can be recovered.
 
@@ -180,6 +219,17 @@ bool QFileSystemModel::remove(const QModelIndex &aindex)
     // failure due to locked files on Windows.
     const QStringList watchedPaths = d->unwatchPathsAt(aindex);
 #endif // filesystemwatcher && Q_OS_WIN
+#if QT_CONFIG(thread)
+    if ((d->asynchronousFileOperations || d->asynchronousRemove) && !path.isEmpty()) {
+        const int operation = d->fileOperationEngine()->start(QFileOperationEngine::Remove,
+                                                              { path }, QString());
+#  if QT_CONFIG(filesystemwatcher) && defined(Q_OS_WIN)
+        d->unwatchedPaths.insert(operation, watchedPaths);
+#  endif
+        emit fileOperationStarted(operation);
+        return true;
+    }
+#endif
     const bool success = (fileInfo.isFile() || fileInfo.isSymLink())
             ? QFile::remove(path) : QDir(path).removeRecursively();
 #if QT_CONFIG(filesystemwatcher) && defined(Q_OS_WIN)
@@ -189,6 +239,27 @@ bool QFileSystemModel::remove(const QModelIndex &aindex)
     return success;
 }
 
+/*!
+    \since 6.10
+
+    Cancels the file \a operation. The items that were not completely copied
+    or moved yet are left as they were, as are the files a deletion did not
+    reach yet. fileOperationFinished() is still emitted once the operation
+    stopped.
+
+    \sa AsynchronousFileOperations
+*/
+void QFileSystemModel::cancelFileOperation(int operation)
+{
+#if QT_CONFIG(thread)
+    Q_D(QFileSystemModel);
+    if (d->fileOperations)
+        d->fileOperations->cancel(operation);
+#else
+    Q_UNUSED(operation);
+#endif
+}
+
 /*!
   Constructs a file system model with the given \a parent.
 */
@@ -231,8 +302,10 @@ QModelIndex QFileSystemModel::index(int row, int column, const QModelIndex &pare
     if (i >= parentNode->visibleChildren.size())
         return QModelIndex();
     const QString &childName = parentNode->visibleChildren.at(i);
-    const QFileSystemModelPrivate::QFileSystemNode *indexNode = parentNode->children.value(childName);
+    QFileSystemModelPrivate::QFileSystemNode *indexNode = d->childNode(parentNode, childName);
     Q_ASSERT(indexNode);
+    d->touch(parentNode);
+    d->touch(indexNode);
 
     return createIndex(row, column, indexNode);
 }
@@ -264,6 +337,27 @@ QModelIndex QFileSystemModel::index(const QString &path, int column) const
     return d->index(node, column);
 }
 
+/*!
+    \since 6.10
+
+    Returns the model item indexes for the given \a paths and \a column, in
+    the same order as \a paths. This gives the same result as calling
+    index() for each of the paths, but the directories that the paths have
+    in common are only looked up once, which is faster when \a paths
+    contains many files of the same directories.
+*/
+QModelIndexList QFileSystemModel::indexes(const QStringList &paths, int column) const
+{
+    Q_D(const QFileSystemModel);
+    using Node = QFileSystemModelPrivate::QFileSystemNode;
+    const QList<Node *> nodes = d->nodes(paths, false);
+    QModelIndexList result;
+    result.reserve(nodes.size());
+    for (const Node *node : nodes)
+        result.append(d->index(node, column));
+    return result;
+}
+
 /*!
     \internal
 
@@ -343,6 +437,13 @@ QFileSystemModelPrivate::QFileSystemNode *QFileSystemModelPrivate::node(const QS
     if (path.isEmpty() || path == myComputer() || path.startsWith(u':'))
         return const_cast<QFileSystemModelPrivate::QFileSystemNode*>(&root);
 
+    // Relative paths depend on the current directory, so only absolute ones are cached
+    const bool cacheable = QDir::isAbsolutePath(path);
+    if (cacheable) {
+        if (QFileSystemNode *cached = cachedNode(path))
+            return cached;
+    }
+
     // Construct the nodes up to the new root path if they need to be built
     QString absolutePath;
 #ifdef Q_OS_WIN32
@@ -355,66 +456,84 @@ QFileSystemModelPrivate::QFileSystemNode *QFileSystemModelPrivate::node(const QS
     else
         absolutePath = QDir(longPath).absolutePath();
 
-    // ### TODO can we use bool QAbstractFileEngine::caseSensitive() const?
-    QStringList pathElements = absolutePath.split(u'/', Qt::SkipEmptyParts);
-    if ((pathElements.isEmpty())
-#if !defined(Q_OS_WIN)
-        && QDir::fromNativeSeparators(longPath) != "/"_L1
-#endif
-        )
-        return const_cast<QFileSystemModelPrivate::QFileSystemNode*>(&root);
-    QModelIndex index = QModelIndex(); // start with "My Computer"
+    QFileSystemModelPrivate::QFileSystemNode *parent = nullptr;
+    QStringList pathElements;
     QString elementPath;
     QChar separator = u'/';
     QString trailingSeparator;
+    bool separatorBeforeFirst = false;
+
+    // Paths below the current root are resolved starting from the root's node,
+    // which spares re-walking the elements leading up to it.
+    const QString rootAbsolutePath = setRootPath && !rootDir.path().isEmpty()
+            ? rootDir.absolutePath() : QString();
+    if (!rootAbsolutePath.isEmpty() && !rootAbsolutePath.endsWith(u'/')
+        && absolutePath.size() > rootAbsolutePath.size() + 1
+        && absolutePath.at(rootAbsolutePath.size()) == u'/'
+        && absolutePath.startsWith(rootAbsolutePath)
+        && (parent = cachedNode(rootAbsolutePath))) {
+        pathElements = absolutePath.sliced(rootAbsolutePath.size() + 1).split(u'/', Qt::SkipEmptyParts);
+        elementPath = rootAbsolutePath;
+        separatorBeforeFirst = true;
+    } else {
+        // ### TODO can we use bool QAbstractFileEngine::caseSensitive() const?
+        pathElements = absolutePath.split(u'/', Qt::SkipEmptyParts);
+        if ((pathElements.isEmpty())
+#if !defined(Q_OS_WIN)
+            && QDir::fromNativeSeparators(longPath) != "/"_L1
+#endif
+            )
+            return const_cast<QFileSystemModelPrivate::QFileSystemNode*>(&root);
+        QModelIndex index = QModelIndex(); // start with "My Computer"
 #if defined(Q_OS_WIN)
-    if (absolutePath.startsWith("//"_L1)) { // UNC path
-        QString host = "\\\\"_L1 + pathElements.constFirst();
-        if (absolutePath == QDir::fromNativeSeparators(host))
-            absolutePath.append(u'/');
-        if (longPath.endsWith(u'/') && !absolutePath.endsWith(u'/'))
-            absolutePath.append(u'/');
-        if (absolutePath.endsWith(u'/'))
-            trailingSeparator = "\\"_L1;
-        int r = 0;
-        auto rootNode = const_cast<QFileSystemModelPrivate::QFileSystemNode*>(&root);
-        auto it = root.children.constFind(host);
-        if (it != root.children.cend()) {
-            host = it.key(); // Normalize case for lookup in visibleLocation()
+        if (absolutePath.startsWith("//"_L1)) { // UNC path
+            QString host = "\\\\"_L1 + pathElements.constFirst();
+            if (absolutePath == QDir::fromNativeSeparators(host))
+                absolutePath.append(u'/');
+            if (longPath.endsWith(u'/') && !absolutePath.endsWith(u'/'))
+                absolutePath.append(u'/');
+            if (absolutePath.endsWith(u'/'))
+                trailingSeparator = "\\"_L1;
+            int r = 0;
+            auto rootNode = const_cast<QFileSystemModelPrivate::QFileSystemNode*>(&root);
+            auto it = root.children.constFind(host);
+            if (it != root.children.cend()) {
+                host = it.key(); // Normalize case for lookup in visibleLocation()
+            } else {
+                if (pathElements.count() == 1 && !absolutePath.endsWith(u'/'))
+                    return rootNode;
+                QFileInfo info(host);
+                if (!info.exists())
+                    return rootNode;
+                QFileSystemModelPrivate *p = const_cast<QFileSystemModelPrivate*>(this);
+                p->addNode(rootNode, host,info);
+                p->addVisibleFiles(rootNode, QStringList(host));
+            }
+            r = rootNode->visibleLocation(host);
+            r = translateVisibleLocation(rootNode, r);
+            index = q->index(r, 0, QModelIndex());
+            pathElements.pop_front();
+            separator = u'\\';
+            elementPath = host;
+            elementPath.append(separator);
         } else {
-            if (pathElements.count() == 1 && !absolutePath.endsWith(u'/'))
-                return rootNode;
-            QFileInfo info(host);
-            if (!info.exists())
-                return rootNode;
-            QFileSystemModelPrivate *p = const_cast<QFileSystemModelPrivate*>(this);
-            p->addNode(rootNode, host,info);
-            p->addVisibleFiles(rootNode, QStringList(host));
-        }
-        r = rootNode->visibleLocation(host);
-        r = translateVisibleLocation(rootNode, r);
-        index = q->index(r, 0, QModelIndex());
-        pathElements.pop_front();
-        separator = u'\\';
-        elementPath = host;
-        elementPath.append(separator);
-    } else {
-        if (!pathElements.at(0).contains(u':')) {
-            QString rootPath = QDir(longPath).rootPath();
-            pathElements.prepend(rootPath);
+            if (!pathElements.at(0).contains(u':')) {
+                QString rootPath = QDir(longPath).rootPath();
+                pathElements.prepend(rootPath);
+            }
         }
-    }
 #else
-    // add the "/" item, since it is a valid path element on Unix
-    if (absolutePath[0] == u'/')
-        pathElements.prepend("/"_L1);
+        // add the "/" item, since it is a valid path element on Unix
+        if (absolutePath[0] == u'/')
+            pathElements.prepend("/"_L1);
 #endif
 
-    QFileSystemModelPrivate::QFileSystemNode *parent = node(index);
+        parent = node(index);
+    }
 
     for (int i = 0; i < pathElements.size(); ++i) {
         QString element = pathElements.at(i);
-        if (i != 0)
+        if (i != 0 || separatorBeforeFirst)
             elementPath.append(separator);
         elementPath.append(element);
         if (i == pathElements.size() - 1)
@@ -428,64 +547,238 @@ QFileSystemModelPrivate::QFileSystemNode *QFileSystemModelPrivate::node(const QS
         if (element.isEmpty())
             return parent;
 #endif
-        bool alreadyExisted = parent->children.contains(element);
-
-        // we couldn't find the path element, we create a new node since we
-        // _know_ that the path is valid
-        if (alreadyExisted) {
-            if ((parent->children.size() == 0)
-                || (parent->caseSensitive()
-                    && parent->children.value(element)->fileName != element)
-                || (!parent->caseSensitive()
-                    && parent->children.value(element)->fileName.toLower() != element.toLower()))
-                alreadyExisted = false;
+        QFileSystemNode *node = resolveChild(parent, element, elementPath, fetch);
+        if (!node)
+            return const_cast<QFileSystemModelPrivate::QFileSystemNode*>(&root);
+#if !defined(Q_OS_WIN)
+        // the file system is case sensitive, continue with the real name
+        if (caseInsensitiveNames && node->fileName != element && i != pathElements.size() - 1) {
+            elementPath.chop(element.size());
+            elementPath.append(node->fileName);
         }
+#endif
+        parent = node;
+    }
+
+    if (cacheable) {
+        cacheNode(absolutePath, parent);
+        if (path != absolutePath)
+            cacheNode(path, parent);
+    }
+    return parent;
+}
+
+/*!
+    \internal
 
-        QFileSystemModelPrivate::QFileSystemNode *node;
-        if (!alreadyExisted) {
+    Returns the child \a element of \a parent, whose path is \a elementPath,
+    creating its node if the file exists and making it visible even if the
+    filters hide it. Returns \nullptr if there is no such file, or if it is
+    hidden by the filters and \a fetch is false.
+*/
+QFileSystemModelPrivate::QFileSystemNode *QFileSystemModelPrivate::resolveChild(QFileSystemNode *parent,
+                                                                                QString element,
+                                                                                QString &elementPath,
+                                                                                bool fetch) const
+{
+    Q_Q(const QFileSystemModel);
+    // in a virtualized directory, create the node if there is an entry for it
+    QFileSystemModelPrivate::QFileSystemNode *node = parent->entries
+            ? childNode(parent, element) : lookupChild(parent, element);
+    const bool alreadyExisted = node != nullptr;
+
+    // we couldn't find the path element, we create a new node since we
+    // _know_ that the path is valid
+    if (!alreadyExisted) {
 #ifdef Q_OS_WIN
-            // Special case: elementPath is a drive root path (C:). If we do not have the trailing
-            // '/' it will be read as a relative path (QTBUG-133746)
-            if (elementPath.length() == 2 && elementPath.at(0).isLetter()
-                && elementPath.at(1) == u':') {
-                elementPath.append(u'/');
-            }
+        // Special case: elementPath is a drive root path (C:). If we do not have the trailing
+        // '/' it will be read as a relative path (QTBUG-133746)
+        if (elementPath.length() == 2 && elementPath.at(0).isLetter()
+            && elementPath.at(1) == u':') {
+            elementPath.append(u'/');
+        }
 #endif
-            // Someone might call ::index("file://cookie/monster/doesn't/like/veggies"),
-            // a path that doesn't exists, I.E. don't blindly create directories.
-            QFileInfo info(elementPath);
-            if (!info.exists())
-                return const_cast<QFileSystemModelPrivate::QFileSystemNode*>(&root);
-            QFileSystemModelPrivate *p = const_cast<QFileSystemModelPrivate*>(this);
-            node = p->addNode(parent, element,info);
+        // Someone might call ::index("file://cookie/monster/doesn't/like/veggies"),
+        // a path that doesn't exists, I.E. don't blindly create directories.
+        QFileInfo info(elementPath);
+        if (!info.exists())
+            return nullptr;
+        QFileSystemModelPrivate *p = const_cast<QFileSystemModelPrivate*>(this);
+        node = p->addNode(parent, element,info);
 #if QT_CONFIG(filesystemwatcher)
-            node->populate(fileInfoGatherer->getInfo(info));
+        node->populate(fileInfoGatherer->getInfo(info));
 #endif
-        } else {
-            node = parent->children.value(element);
-        }
-
-        Q_ASSERT(node);
-        if (!node->isVisible) {
-            // It has been filtered out
-            if (alreadyExisted && node->hasInformation() && !fetch)
-                return const_cast<QFileSystemModelPrivate::QFileSystemNode*>(&root);
-
-            QFileSystemModelPrivate *p = const_cast<QFileSystemModelPrivate*>(this);
-            p->addVisibleFiles(parent, QStringList(element));
-            if (!p->bypassFilters.contains(node))
-                p->bypassFilters[node] = 1;
-            QString dir = q->filePath(this->index(parent));
-            if (!node->hasInformation() && fetch) {
-                Fetching f = { std::move(dir), std::move(element), node };
-                p->toFetch.append(std::move(f));
-                p->fetchingTimer.start(0, const_cast<QFileSystemModel*>(q));
+    }
+
+    Q_ASSERT(node);
+    if (!node->isVisible) {
+        // It has been filtered out
+        if (alreadyExisted && node->hasAttributes() && !fetch)
+            return nullptr;
+
+        QFileSystemModelPrivate *p = const_cast<QFileSystemModelPrivate*>(this);
+        // element may only match the name of the node without regard to case
+        p->addVisibleFiles(parent, QStringList(node->fileName));
+        p->setBypassFilters(node);
+        if (!node->hasInformation() && fetch) {
+            // Siblings are usually queued one after the other, e.g. when
+            // restoring a selection, so share the path of their directory
+            QString dir = !toFetch.isEmpty() && toFetch.constLast().node->parent == parent
+                    ? toFetch.constLast().dir : q->filePath(this->index(parent));
+            Fetching f = { std::move(dir), node->fileName, node };
+            p->toFetch.append(std::move(f));
+            p->fetchingTimer.start(0, const_cast<QFileSystemModel*>(q));
+        }
+    }
+    return node;
+}
+
+/*!
+    \internal
+
+    Same as calling node() for each of \a paths. The paths are resolved in
+    sorted order, keeping the nodes of the directories that lead to the
+    previous path, so that only the elements a clean absolute path doesn't
+    share with it are looked up.
+*/
+QList<QFileSystemModelPrivate::QFileSystemNode *> QFileSystemModelPrivate::nodes(const QStringList &paths,
+                                                                                 bool fetch) const
+{
+    QList<QFileSystemNode *> result(paths.size());
+    QList<qsizetype> order(paths.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&paths](qsizetype l, qsizetype r) {
+        return paths.at(l) < paths.at(r);
+    });
+
+    struct ResolvedPrefix {
+        QStringView path;
+        QFileSystemNode *node;
+    };
+    // the nodes of the previous path and of its directories, outermost first
+    QVarLengthArray<ResolvedPrefix, 16> prefixes;
+    for (const qsizetype i : std::as_const(order)) {
+        const QString &path = paths.at(i);
+        const bool clean = QDir::isAbsolutePath(path) && !path.endsWith(u'/')
+                && QDir::cleanPath(path) == path;
+        while (clean && !prefixes.isEmpty()) {
+            const QStringView prefix = prefixes.constLast().path;
+            if (path.size() > prefix.size() && path.at(prefix.size()) == u'/'
+                && QStringView(path).startsWith(prefix)) {
+                break;
             }
+            prefixes.pop_back();
+        }
+
+        if (!clean || prefixes.isEmpty()) {
+            QFileSystemNode *n = node(path, fetch);
+            result[i] = n;
+            prefixes.clear();
+            if (!clean)
+                continue;
+            // the directories of a clean path are the ancestors of its node
+            for (qsizetype end = path.size(); end > 0 && n != &root; n = n->parent) {
+                prefixes.append({ QStringView(path).first(end), n });
+                end = path.lastIndexOf(u'/', end - 1);
+            }
+            std::reverse(prefixes.begin(), prefixes.end());
+            continue;
+        }
+
+        QFileSystemNode *n = prefixes.constLast().node;
+        for (qsizetype start = prefixes.constLast().path.size() + 1; n && start <= path.size();) {
+            qsizetype end = path.indexOf(u'/', start);
+            if (end < 0)
+                end = path.size();
+            QString element = path.sliced(start, end - start);
+#ifdef Q_OS_WIN
+            // as in node(), a name that is empty once stripped refers to its parent
+            chopSpaceAndDot(element);
+            if (element.isEmpty())
+                break;
+#endif
+            QString elementPath = path.first(end);
+            n = resolveChild(n, std::move(element), elementPath, fetch);
+            if (n)
+                prefixes.append({ QStringView(path).first(end), n });
+            start = end + 1;
+        }
+        if (n) {
+            cacheNode(path, n);
+            result[i] = n;
+        } else {
+            result[i] = const_cast<QFileSystemNode *>(&root);
         }
-        parent = node;
     }
+    return result;
+}
 
-    return parent;
+/*!
+    \internal
+
+    Returns the node cached for the absolute \a path, or \nullptr if there is
+    none or if the node or one of its ancestors has since been filtered out.
+*/
+QFileSystemModelPrivate::QFileSystemNode *QFileSystemModelPrivate::cachedNode(const QString &path) const
+{
+    const NodeCacheEntry *entry = nodeCache.object(path);
+    if (!entry)
+        return nullptr;
+    for (const QFileSystemNode *n = entry->node; n && n != &root; n = n->parent) {
+        if (!n->isVisible)
+            return nullptr;
+    }
+    return entry->node;
+}
+
+/*!
+    \internal
+*/
+void QFileSystemModelPrivate::cacheNode(const QString &path, QFileSystemNode *node) const
+{
+    if (node == &root)
+        return;
+    nodeCache.insert(path, new NodeCacheEntry{node});
+}
+
+/*!
+    \internal
+
+    Returns the node of \a path if the model has loaded it, without creating
+    nodes or touching the file system; otherwise returns \nullptr. Children
+    that only have an entry in a virtualized directory are not loaded.
+*/
+QFileSystemModelPrivate::QFileSystemNode *QFileSystemModelPrivate::loadedNode(const QString &path) const
+{
+    if (path.isEmpty() || path == myComputer())
+        return const_cast<QFileSystemNode *>(&root);
+    if (QDir::isAbsolutePath(path)) {
+        if (QFileSystemNode *cached = cachedNode(path))
+            return cached;
+    }
+
+    const QString absolutePath = QDir(path).absolutePath();
+    QStringList pathElements = absolutePath.split(u'/', Qt::SkipEmptyParts);
+#if defined(Q_OS_WIN)
+    if (absolutePath.startsWith("//"_L1)) { // UNC path
+        if (pathElements.isEmpty())
+            return nullptr;
+        pathElements.first().prepend("\\"_L1);
+    } else if (!pathElements.isEmpty() && !pathElements.constFirst().contains(u':')) {
+        pathElements.prepend(QDir(path).rootPath());
+    }
+#else
+    if (absolutePath.startsWith(u'/'))
+        pathElements.prepend("/"_L1);
+#endif
+
+    const QFileSystemNode *n = &root;
+    for (const QString &element : std::as_const(pathElements)) {
+        n = lookupChild(n, element);
+        if (!n)
+            return nullptr;
+    }
+    return const_cast<QFileSystemNode *>(n);
 }
 
 /*!
@@ -497,17 +790,32 @@ void QFileSystemModel::timerEvent(QTimerEvent *event)
     if (event->timerId() == d->fetchingTimer.timerId()) {
         d->fetchingTimer.stop();
 #if QT_CONFIG(filesystemwatcher)
-        for (int i = 0; i < d->toFetch.size(); ++i) {
-            const QFileSystemModelPrivate::QFileSystemNode *node = d->toFetch.at(i).node;
-            if (!node->hasInformation()) {
-                d->fileInfoGatherer->fetchExtendedInformation(d->toFetch.at(i).dir,
-                                                 QStringList(d->toFetch.at(i).file));
-            } else {
-                // qDebug("yah!, you saved a little gerbil soul");
-            }
+        // one request per directory, asking for each file once
+        QStringList dirs;
+        QHash<QString, QStringList> files;
+        QSet<const QFileSystemModelPrivate::QFileSystemNode *> queued;
+        queued.reserve(d->toFetch.size());
+        for (const QFileSystemModelPrivate::Fetching &fetching : std::as_const(d->toFetch)) {
+            if (fetching.node->hasInformation())
+                continue; // qDebug("yah!, you saved a little gerbil soul");
+            if (queued.contains(fetching.node))
+                continue;
+            queued.insert(fetching.node);
+            QStringList &dirFiles = files[fetching.dir];
+            if (dirFiles.isEmpty())
+                dirs.append(fetching.dir);
+            dirFiles.append(fetching.file);
         }
+        for (const QString &dir : std::as_const(dirs))
+            d->fileInfoGatherer->fetchExtendedInformation(dir, files.value(dir));
 #endif
         d->toFetch.clear();
+    } else if (event->timerId() == d->trimTimer.timerId()) {
+        d->trimTimer.stop();
+        d->trimVirtualDirectories();
+    } else if (event->timerId() == d->evictionTimer.timerId()) {
+        d->evictionTimer.stop();
+        d->evictNodes();
     }
 }
 
@@ -529,13 +837,36 @@ bool QFileSystemModel::isDir(const QModelIndex &index) const
 
 /*!
     Returns the size in bytes of \a index. If the file does not exist, 0 is returned.
+
+    For directories, this is the total size of the files below them if the
+    ComputeDirectorySizes option is set and that size has been computed,
+    and 0 otherwise.
   */
 qint64 QFileSystemModel::size(const QModelIndex &index) const
 {
     Q_D(const QFileSystemModel);
     if (!index.isValid())
         return 0;
-    return d->node(index)->size();
+    return d->node(index)->sortSize();
+}
+
+/*!
+    \since 6.10
+
+    Returns the number of files and directories below the directory at
+    \a index, at any depth, or -1 if it is not known.
+
+    Item counts are only computed if the ComputeDirectorySizes option is set.
+
+    \sa size()
+*/
+qint64 QFileSystemModel::itemCount(const QModelIndex &index) const
+{
+    Q_D(const QFileSystemModel);
+    if (!index.isValid())
+        return -1;
+    const QFileSystemModelPrivate::QFileSystemNode *n = d->node(index);
+    return n->isDir() ? n->totalItems : -1;
 }
 
 /*!
@@ -546,7 +877,7 @@ QString QFileSystemModel::type(const QModelIndex &index) const
     Q_D(const QFileSystemModel);
     if (!index.isValid())
         return QString();
-    return d->node(index)->type();
+    return d->decorated(d->node(index))->type();
 }
 
 /*!
@@ -602,7 +933,7 @@ QModelIndex QFileSystemModel::parent(const QModelIndex &index) const
     // get the parent's row
     QFileSystemModelPrivate::QFileSystemNode *grandParentNode = parentNode->parent;
     Q_ASSERT(grandParentNode->children.contains(parentNode->fileName));
-    int visualRow = d->translateVisibleLocation(grandParentNode, grandParentNode->visibleLocation(grandParentNode->children.value(parentNode->fileName)->fileName));
+    int visualRow = d->translateVisibleLocation(grandParentNode, grandParentNode->visibleLocation(parentNode));
     if (visualRow == -1)
         return QModelIndex();
     return createIndex(visualRow, 0, parentNode);
@@ -625,10 +956,47 @@ QModelIndex QFileSystemModelPrivate::index(const QFileSystemModelPrivate::QFileS
     if (!node->isVisible)
         return QModelIndex();
 
-    int visualRow = translateVisibleLocation(parentNode, parentNode->visibleLocation(node->fileName));
+    int visualRow = translateVisibleLocation(parentNode, parentNode->visibleLocation(node));
     return q->createIndex(visualRow, column, const_cast<QFileSystemNode*>(node));
 }
 
+/*!
+    \internal
+
+    Returns the position of \a child in visibleChildren, or -1 if it is not
+    visible. The row cached in the child is checked first, so that looking
+    up the rows of a large directory, as index() and parent() do, doesn't
+    search its visible children every time.
+*/
+int QFileSystemModelPrivate::QFileSystemNode::visibleLocation(const QFileSystemNode *child) const
+{
+    const int size = visibleChildren.size();
+    const int cached = child->visibleRow;
+    if (cached >= 0 && cached < size && visibleChildren.at(cached) == child->fileName)
+        return cached;
+    // Rows that move up are stamped again, see updateVisibleRows(), and new
+    // rows are appended, so look before the cached row first, or from the end
+    int row = int(visibleChildren.lastIndexOf(child->fileName, cached < 0 ? -1 : qMin(cached, size - 1)));
+    if (row < 0 && cached >= 0)
+        row = int(visibleChildren.indexOf(child->fileName, cached + 1));
+    child->visibleRow = row;
+    return row;
+}
+
+/*!
+    \internal
+
+    Stores their row in the nodes of the visible children from \a from on,
+    after rows before them have been removed.
+*/
+void QFileSystemModelPrivate::QFileSystemNode::updateVisibleRows(int from) const
+{
+    for (int row = qMax(0, from); row < visibleChildren.size(); ++row) {
+        if (const QFileSystemNode *child = children.value(visibleChildren.at(row)))
+            child->visibleRow = row;
+    }
+}
+
 /*!
     \reimp
 */
@@ -670,6 +1038,10 @@ void QFileSystemModel::fetchMore(const QModelIndex &parent)
     if (indexNode->populatedChildren)
         return;
     indexNode->populatedChildren = true;
+    d->touch(indexNode);
+    d->invalidatePublished(indexNode);
+    if (d->snapshotData && d->populateFromSnapshot(indexNode))
+        return;
 #if QT_CONFIG(filesystemwatcher)
     d->fileInfoGatherer->list(filePath(parent));
 #endif
@@ -731,47 +1103,82 @@ QVariant QFileSystemModel::data(const QModelIndex &index, int role) const
     if (!index.isValid() || index.model() != this)
         return QVariant();
 
+    QString path;
+    return d->data(index, role, path);
+}
+
+/*!
+    \reimp
+
+    All the roles in \a roleDataSpan are served from a single lookup of the
+    item at \a index, which also shares its path between the roles.
+
+    \since 6.10
+*/
+void QFileSystemModel::multiData(const QModelIndex &index, QModelRoleDataSpan roleDataSpan) const
+{
+    Q_D(const QFileSystemModel);
+    if (!index.isValid() || index.model() != this) {
+        for (QModelRoleData &roleData : roleDataSpan)
+            roleData.clearData();
+        return;
+    }
+
+    QString path;
+    for (QModelRoleData &roleData : roleDataSpan)
+        roleData.setData(d->data(index, roleData.role(), path));
+}
+
+/*!
+    \internal
+
+    Returns the data of \a index for \a role. \a path holds the path of
+    \a index once it has been built, so that it is built at most once when
+    several roles are asked for; it must be null the first time.
+*/
+QVariant QFileSystemModelPrivate::data(const QModelIndex &index, int role, QString &path) const
+{
     switch (role) {
     case Qt::EditRole:
-        if (index.column() == QFileSystemModelPrivate::NameColumn)
-            return d->name(index);
+        if (index.column() == NameColumn)
+            return name(index, path);
         Q_FALLTHROUGH();
     case Qt::DisplayRole:
         switch (index.column()) {
-        case QFileSystemModelPrivate::NameColumn: return d->displayName(index);
-        case QFileSystemModelPrivate::SizeColumn: return d->size(index);
-        case QFileSystemModelPrivate::TypeColumn: return d->type(index);
-        case QFileSystemModelPrivate::TimeColumn: return d->time(index);
+        case NameColumn: return displayName(index, path);
+        case SizeColumn: return size(index);
+        case TypeColumn: return type(index);
+        case TimeColumn: return time(index);
         default:
             qWarning("data: invalid display value column %d", index.column());
             break;
         }
         break;
-    case FilePathRole:
-        return filePath(index);
-    case FileNameRole:
-        return d->name(index);
-    case FileInfoRole:
-        return QVariant::fromValue(fileInfo(index));
+    case QFileSystemModel::FilePathRole:
+        return resolvedFilePath(node(index), path);
+    case QFileSystemModel::FileNameRole:
+        return name(index, path);
+    case QFileSystemModel::FileInfoRole:
+        return QVariant::fromValue(node(index)->fileInfo());
     case Qt::DecorationRole:
-        if (index.column() == QFileSystemModelPrivate::NameColumn) {
-            QIcon icon = d->icon(index);
+        if (index.column() == NameColumn) {
+            QIcon icon = this->icon(index);
 #if QT_CONFIG(filesystemwatcher)
             if (icon.isNull()) {
                 using P = QAbstractFileIconProvider;
-                if (auto *provider = d->fileInfoGatherer->iconProvider())
-                    icon = provider->icon(d->node(index)->isDir() ? P::Folder: P::File);
+                if (auto *provider = fileInfoGatherer->iconProvider())
+                    icon = provider->icon(node(index)->isDir() ? P::Folder: P::File);
             }
 #endif // filesystemwatcher
             return icon;
         }
         break;
     case Qt::TextAlignmentRole:
-        if (index.column() == QFileSystemModelPrivate::SizeColumn)
+        if (index.column() == SizeColumn)
             return QVariant(Qt::AlignTrailing | Qt::AlignVCenter);
         break;
-    case FilePermissions:
-        int p = permissions(index);
+    case QFileSystemModel::FilePermissions:
+        int p = node(index)->permissions();
         return p;
     }
 
@@ -785,19 +1192,28 @@ QString QFileSystemModelPrivate::size(const QModelIndex &index) const
 {
     if (!index.isValid())
         return QString();
-    const QFileSystemNode *n = node(index);
+    QFileSystemNode *n = node(index);
+    qint64 bytes = n->size();
     if (n->isDir()) {
+        if (n->totalSize < 0) {
 #ifdef Q_OS_MAC
-        return "--"_L1;
+            return "--"_L1;
 #else
-        return ""_L1;
+            return ""_L1;
 #endif
+        }
+        bytes = n->totalSize;
     // Windows   - ""
     // OS X      - "--"
     // Konqueror - "4 KB"
     // Nautilus  - "9 items" (the number of children)
     }
-    return size(n->size());
+    QFileSystemNode::DisplayStrings &strings = displayStrings(n);
+    if (strings.size.isNull() || strings.bytes != bytes) {
+        strings.bytes = bytes;
+        strings.size = size(bytes);
+    }
+    return strings.size;
 }
 
 QString QFileSystemModelPrivate::size(qint64 bytes)
@@ -813,13 +1229,42 @@ QString QFileSystemModelPrivate::time(const QModelIndex &index) const
     if (!index.isValid())
         return QString();
 #if QT_CONFIG(datestring)
-    return QLocale::system().toString(node(index)->lastModified(QTimeZone::LocalTime), QLocale::ShortFormat);
+    QFileSystemNode *n = node(index);
+    QFileSystemNode::DisplayStrings &strings = displayStrings(n);
+    if (strings.time.isNull())
+        strings.time = QLocale::system().toString(n->lastModified(QTimeZone::LocalTime), QLocale::ShortFormat);
+    return strings.time;
 #else
     Q_UNUSED(index);
     return QString();
 #endif
 }
 
+/*!
+    \internal
+
+    Returns the display strings of \a node, which are cleared when the node's
+    information is updated or the locale changed since they were built.
+*/
+QFileSystemModelPrivate::QFileSystemNode::DisplayStrings &
+QFileSystemModelPrivate::displayStrings(QFileSystemNode *node) const
+{
+    // the language, script and territory don't allocate, unlike the name
+    const QLocale locale = QLocale::system();
+    if (locale.language() != displayLanguage || locale.script() != displayScript
+        || locale.territory() != displayTerritory) {
+        displayLanguage = locale.language();
+        displayScript = locale.script();
+        displayTerritory = locale.territory();
+        ++localeGeneration;
+    }
+    if (!node->displayStrings)
+        node->displayStrings = std::make_unique<QFileSystemNode::DisplayStrings>();
+    if (node->displayStrings->localeGeneration != localeGeneration)
+        *node->displayStrings = { localeGeneration };
+    return *node->displayStrings;
+}
+
 /*
     \internal
 */
@@ -827,13 +1272,13 @@ QString QFileSystemModelPrivate::type(const QModelIndex &index) const
 {
     if (!index.isValid())
         return QString();
-    return node(index)->type();
+    return decorated(node(index))->type();
 }
 
 /*!
     \internal
 */
-QString QFileSystemModelPrivate::name(const QModelIndex &index) const
+QString QFileSystemModelPrivate::name(const QModelIndex &index, QString &path) const
 {
     if (!index.isValid())
         return QString();
@@ -843,7 +1288,7 @@ QString QFileSystemModelPrivate::name(const QModelIndex &index) const
         fileInfoGatherer->resolveSymlinks() &&
 #endif
         !resolvedSymLinks.isEmpty() && dirNode->isSymLink(/* ignoreNtfsSymLinks = */ true)) {
-        QString fullPath = QDir::fromNativeSeparators(filePath(index));
+        QString fullPath = QDir::fromNativeSeparators(filePath(index, path));
         return resolvedSymLinks.value(fullPath, dirNode->fileName);
     }
     return dirNode->fileName;
@@ -852,14 +1297,14 @@ QString QFileSystemModelPrivate::name(const QModelIndex &index) const
 /*!
     \internal
 */
-QString QFileSystemModelPrivate::displayName(const QModelIndex &index) const
+QString QFileSystemModelPrivate::displayName(const QModelIndex &index, QString &path) const
 {
 #if defined(Q_OS_WIN)
     QFileSystemNode *dirNode = node(index);
     if (!dirNode->volumeName.isEmpty())
         return dirNode->volumeName;
 #endif
-    return name(index);
+    return name(index, path);
 }
 
 /*!
@@ -869,7 +1314,7 @@ QIcon QFileSystemModelPrivate::icon(const QModelIndex &index) const
 {
     if (!index.isValid())
         return QIcon();
-    return node(index)->icon();
+    return decorated(node(index))->icon();
 }
 
 /*!
@@ -924,17 +1369,28 @@ bool QFileSystemModel::setData(const QModelIndex &idx, const QVariant &value, in
 
         QFileSystemModelPrivate::QFileSystemNode *indexNode = d->node(idx);
         QFileSystemModelPrivate::QFileSystemNode *parentNode = indexNode->parent;
-        int visibleLocation = parentNode->visibleLocation(parentNode->children.value(indexNode->fileName)->fileName);
+        int visibleLocation = parentNode->visibleLocation(indexNode);
 
         parentNode->visibleChildren.removeAt(visibleLocation);
         std::unique_ptr<QFileSystemModelPrivate::QFileSystemNode> nodeToRename(parentNode->children.take(oldName));
+        d->invalidatePathCaches();
+        d->nodeBytes -= d->nodeFootprint(nodeToRename.get());
         nodeToRename->fileName = newName;
+        d->nodeBytes += d->nodeFootprint(nodeToRename.get());
         nodeToRename->parent = parentNode;
 #if QT_CONFIG(filesystemwatcher)
         nodeToRename->populate(d->fileInfoGatherer->getInfo(QFileInfo(parentPath, newName)));
 #endif
         nodeToRename->isVisible = true;
-        parentNode->children[newName] = nodeToRename.release();
+        if (parentNode->entries)
+            d->removeEntry(parentNode, oldName);
+        QFileSystemModelPrivate::QFileSystemNode *renamedNode = nodeToRename.release();
+        parentNode->children.insert(d->nameKey(newName), renamedNode);
+        if (d->searchIndex) {
+            d->searchIndex->remove(parentNode, oldName);
+            d->searchIndex->insert(parentNode, newName);
+        }
+        d->syncEntry(parentNode, renamedNode);
         parentNode->visibleChildren.insert(visibleLocation, newName);
 
         d->delayedSort();
@@ -1069,7 +1525,7 @@ public:
             if (left ^ right)
                 return left;
 
-            qint64 sizeDifference = l->size() - r->size();
+            qint64 sizeDifference = l->sortSize() - r->sortSize();
             if (sizeDifference == 0)
                 return naturalCompare.compare(l->fileName, r->fileName) < 0;
 
@@ -1103,8 +1559,55 @@ public:
         return compareNodes(l, r);
     }
 
+    bool compareEntries(const QFileSystemModelPrivate::QFileSystemNode::Entry &l,
+                        const QFileSystemModelPrivate::QFileSystemNode::Entry &r) const
+    {
+        using Node = QFileSystemModelPrivate::QFileSystemNode;
+        const bool leftIsDir = l.attributes & Node::Dir;
+        const bool rightIsDir = r.attributes & Node::Dir;
+        switch (sortColumn) {
+        case QFileSystemModelPrivate::NameColumn:
+#ifndef Q_OS_MAC
+            // place directories before files
+            if (leftIsDir ^ rightIsDir)
+                return leftIsDir;
+#endif
+            return naturalCompare.compare(l.fileName, r.fileName) < 0;
+        case QFileSystemModelPrivate::SizeColumn:
+            // Directories go first
+            if (leftIsDir ^ rightIsDir)
+                return leftIsDir;
+            if (l.size == r.size)
+                return naturalCompare.compare(l.fileName, r.fileName) < 0;
+            return l.size < r.size;
+        case QFileSystemModelPrivate::TypeColumn:
+        {
+            // The type string comes from the icon provider, which is only asked
+            // once a node is created, so group by kind and suffix instead.
+            if (leftIsDir ^ rightIsDir)
+                return leftIsDir;
+            int compare = naturalCompare.compare(suffix(l.fileName), suffix(r.fileName));
+            if (compare == 0)
+                return naturalCompare.compare(l.fileName, r.fileName) < 0;
+            return compare < 0;
+        }
+        case QFileSystemModelPrivate::TimeColumn:
+            if (l.lastModified == r.lastModified)
+                return naturalCompare.compare(l.fileName, r.fileName) < 0;
+            return l.lastModified < r.lastModified;
+        }
+        Q_ASSERT(false);
+        return false;
+    }
+
 
 private:
+    static QStringView suffix(const QString &fileName)
+    {
+        const qsizetype dot = fileName.lastIndexOf(u'.');
+        return dot < 0 ? QStringView() : QStringView(fileName).sliced(dot + 1);
+    }
+
     QCollator naturalCompare;
     int sortColumn;
 };
@@ -1116,19 +1619,19 @@ private:
 */
 void QFileSystemModelPrivate::sortChildren(int column, const QModelIndex &parent)
 {
-    Q_Q(QFileSystemModel);
     QFileSystemModelPrivate::QFileSystemNode *indexNode = node(parent);
+    if (indexNode->entries) {
+        sortEntries(column, indexNode);
+        return;
+    }
     if (indexNode->children.size() == 0)
         return;
 
     QList<QFileSystemModelPrivate::QFileSystemNode *> values;
-
-    for (auto iterator = indexNode->children.constBegin(), cend = indexNode->children.constEnd(); iterator != cend; ++iterator) {
-        if (filtersAcceptsNode(iterator.value())) {
-            values.append(iterator.value());
-        } else {
-            iterator.value()->isVisible = false;
-        }
+    filterChildren(indexNode, values);
+    if (column == TypeColumn) {
+        for (QFileSystemNode *node : std::as_const(values))
+            decorated(node);
     }
     QFileSystemModelSorter ms(column);
     std::sort(values.begin(), values.end(), ms);
@@ -1138,17 +1641,61 @@ void QFileSystemModelPrivate::sortChildren(int column, const QModelIndex &parent
     indexNode->dirtyChildrenIndex = -1;
     indexNode->visibleChildren.reserve(values.size());
     for (QFileSystemNode *node : std::as_const(values)) {
+        node->visibleRow = indexNode->visibleChildren.size();
         indexNode->visibleChildren.append(node->fileName);
         node->isVisible = true;
     }
 
     if (!disableRecursiveSort) {
-        for (int i = 0; i < q->rowCount(parent); ++i) {
-            const QModelIndex childIndex = q->index(i, 0, parent);
-            QFileSystemModelPrivate::QFileSystemNode *indexNode = node(childIndex);
-            //Only do a recursive sort on visible nodes
-            if (indexNode->isVisible)
-                sortChildren(column, childIndex);
+        // Only the visible nodes are sorted, and there is nothing to sort in
+        // the ones without children, such as all the files of a flat directory
+        for (QFileSystemNode *node : std::as_const(values)) {
+            if (!node->children.isEmpty() || node->entries)
+                sortChildren(column, index(node));
+        }
+    }
+}
+
+/*
+    \internal
+
+    Sort all of the children of the virtualized directory \a parentNode using
+    their entries, without creating nodes for them.
+*/
+void QFileSystemModelPrivate::sortEntries(int column, QFileSystemNode *parentNode)
+{
+    using Entry = QFileSystemNode::Entry;
+    QList<const Entry *> values;
+    values.reserve(parentNode->entries->size());
+    for (auto it = parentNode->entries->begin(), end = parentNode->entries->end(); it != end; ++it) {
+        const bool accept = filtersAcceptsEntry(parentNode, *it);
+        it->isVisible = accept;
+        if (QFileSystemNode *child = parentNode->children.value(it->fileName))
+            child->isVisible = accept;
+        if (accept)
+            values.append(&*it);
+    }
+    const QFileSystemModelSorter ms(column);
+    std::sort(values.begin(), values.end(), [&ms](const Entry *l, const Entry *r) {
+        return ms.compareEntries(*l, *r);
+    });
+    parentNode->visibleChildren.clear();
+    parentNode->dirtyChildrenIndex = -1;
+    parentNode->visibleChildren.reserve(values.size());
+    for (const Entry *entry : std::as_const(values)) {
+        if (!parentNode->children.isEmpty()) {
+            if (QFileSystemNode *child = parentNode->children.value(entry->fileName))
+                child->visibleRow = parentNode->visibleChildren.size();
+        }
+        parentNode->visibleChildren.append(entry->fileName);
+    }
+
+    if (!disableRecursiveSort) {
+        // children without a node don't have children of their own
+        const QList<QFileSystemNode *> materialized = parentNode->children.values();
+        for (QFileSystemNode *child : materialized) {
+            if (child->isVisible)
+                sortChildren(column, index(child));
         }
     }
 }
@@ -1177,10 +1724,19 @@ void QFileSystemModel::sort(int column, Qt::SortOrder order)
     }
     d->sortOrder = order;
 
+    // The sorted nodes know their new row, see QFileSystemNode::visibleLocation()
     QModelIndexList newList;
     newList.reserve(oldNodes.size());
-    for (const auto &[node, col]: std::as_const(oldNodes))
-        newList.append(d->index(node, col));
+    for (const auto &[node, col]: std::as_const(oldNodes)) {
+        QFileSystemModelPrivate::QFileSystemNode *parentNode = node ? node->parent : nullptr;
+        if (node == &d->root || !parentNode || !node->isVisible) {
+            newList.append(QModelIndex());
+            continue;
+        }
+        const int visibleLocation = parentNode->visibleLocation(node);
+        newList.append(visibleLocation < 0 ? QModelIndex()
+                       : createIndex(d->translateVisibleLocation(parentNode, visibleLocation), col, node));
+    }
 
     changePersistentIndexList(oldList, newList);
     emit layoutChanged({}, VerticalSortHint);
@@ -1202,17 +1758,22 @@ QStringList QFileSystemModel::mimeTypes() const
 
     If the list of indexes is empty, \nullptr is returned rather than a
     serialized empty list.
+
+    The URLs of the items are only built when they are first retrieved from
+    the returned object, so that starting to drag many items is cheap.
 */
 QMimeData *QFileSystemModel::mimeData(const QModelIndexList &indexes) const
 {
-    QList<QUrl> urls;
-    QList<QModelIndex>::const_iterator it = indexes.begin();
-    for (; it != indexes.end(); ++it)
-        if ((*it).column() == QFileSystemModelPrivate::NameColumn)
-            urls << QUrl::fromLocalFile(filePath(*it));
-    QMimeData *data = new QMimeData();
-    data->setUrls(urls);
-    return data;
+    Q_D(const QFileSystemModel);
+    // The URLs are only built when the drop target asks for them, see
+    // QFileSystemModelMimeData
+    QList<const QFileSystemModelPrivate::QFileSystemNode *> nodes;
+    nodes.reserve(indexes.size());
+    for (const QModelIndex &index : indexes) {
+        if (index.column() == QFileSystemModelPrivate::NameColumn)
+            nodes.append(d->node(index));
+    }
+    return new QFileSystemModelMimeData(const_cast<QFileSystemModelPrivate *>(d), std::move(nodes));
 }
 
 /*!
@@ -1231,6 +1792,42 @@ bool QFileSystemModel::dropMimeData(const QMimeData *data, Qt::DropAction action
     if (!parent.isValid() || isReadOnly())
         return false;
 
+#if QT_CONFIG(thread)
+    Q_D(QFileSystemModel);
+    if (d->asynchronousFileOperations) {
+        QFileOperationEngine::Kind kind;
+        switch (action) {
+        case Qt::CopyAction:
+            kind = QFileOperationEngine::Copy;
+            break;
+        case Qt::LinkAction:
+            kind = QFileOperationEngine::Link;
+            break;
+        case Qt::MoveAction:
+            kind = QFileOperationEngine::Move;
+            break;
+        default:
+            return false;
+        }
+        const QString destination = filePath(parent);
+        QStringList sources;
+        const QList<QUrl> urls = data->urls();
+        sources.reserve(urls.size());
+        for (const QUrl &url : urls) {
+            const QString source = url.toLocalFile();
+            // a directory can't be copied or moved into itself
+            if (kind != QFileOperationEngine::Link
+                && QFileOperationEngine::isWithin(destination, source)) {
+                return false;
+            }
+            sources.append(source);
+        }
+        const int operation = d->fileOperationEngine()->start(kind, sources, destination);
+        emit fileOperationStarted(operation);
+        return true;
+    }
+#endif
+
     bool success = true;
     QString to = filePath(parent) + QDir::separator();
 
@@ -1305,6 +1902,28 @@ QHash<int, QByteArray> QFileSystemModel::roleNames() const
     This sets the QFileIconProvider::DontUseCustomDirectoryIcons
     option in the icon provider accordingly.
 
+    \value ComputeDirectorySizes Compute the total size and the number of
+    items below each directory in the background (since 6.10). The size
+    column then shows them, and sorts by them; see size() and itemCount().
+    Changes observed in loaded directories update the totals of their
+    parents without scanning again.
+
+    \value CaseInsensitiveNames Look files up by name without regard to case,
+    as on Windows, where this option has no effect (since 6.10). index()
+    then finds \c{override/textures.tpc} when the files the model has loaded
+    are \c{Override/TEXTURES.tpc}. If a directory holds several files whose
+    names only differ in case, the model shows all of them, and a name that
+    matches one of them exactly finds that one; otherwise it finds any one of
+    them.
+
+    \value AsynchronousFileOperations Copy, move and link the files dropped
+    on the model, and delete the files passed to remove(), in the background
+    (since 6.10). dropMimeData() and remove() then return once the operation
+    started, and reports it with fileOperationStarted(),
+    fileOperationProgress() and fileOperationFinished(). The items appear in
+    the model as soon as each of them is done. Existing files are never
+    overwritten.
+
     \sa resolveSymlinks
 */
 
@@ -1370,18 +1989,45 @@ void QFileSystemModel::setOptions(Options options)
             qWarning("Setting QFileSystemModel::DontUseCustomDirectoryIcons has no effect when no provider is used");
         }
     }
-}
 
-QFileSystemModel::Options QFileSystemModel::options() const
-{
-    QFileSystemModel::Options result;
+#if QT_CONFIG(filesystemwatcher)
+    if (changed.testFlag(ComputeDirectorySizes))
+        d->setComputeDirectorySizes(options.testFlag(ComputeDirectorySizes));
+#endif
+
+#if !defined(Q_OS_WIN)
+    if (changed.testFlag(CaseInsensitiveNames)) {
+        Q_D(QFileSystemModel);
+        d->setCaseInsensitiveNames(options.testFlag(CaseInsensitiveNames));
+    }
+#endif
+
+#if QT_CONFIG(thread)
+    if (changed.testFlag(AsynchronousFileOperations)) {
+        Q_D(QFileSystemModel);
+        d->asynchronousFileOperations = options.testFlag(AsynchronousFileOperations);
+    }
+#endif
+}
+
+QFileSystemModel::Options QFileSystemModel::options() const
+{
+    QFileSystemModel::Options result;
     result.setFlag(DontResolveSymlinks, !resolveSymlinks());
 #if QT_CONFIG(filesystemwatcher)
     Q_D(const QFileSystemModel);
     result.setFlag(DontWatchForChanges, !d->fileInfoGatherer->isWatching());
+    result.setFlag(ComputeDirectorySizes, d->computeDirectorySizes);
 #else
     result.setFlag(DontWatchForChanges);
 #endif
+    {
+        Q_D(const QFileSystemModel);
+#if !defined(Q_OS_WIN)
+        result.setFlag(CaseInsensitiveNames, d->caseInsensitiveNames);
+#endif
+        result.setFlag(AsynchronousFileOperations, d->asynchronousFileOperations);
+    }
     if (auto provider = iconProvider()) {
         result.setFlag(DontUseCustomDirectoryIcons,
                        provider->options().testFlag(QAbstractFileIconProvider::DontUseCustomDirectoryIcons));
@@ -1396,19 +2042,33 @@ QFileSystemModel::Options QFileSystemModel::options() const
 QString QFileSystemModel::filePath(const QModelIndex &index) const
 {
     Q_D(const QFileSystemModel);
-    QString fullPath = d->filePath(index);
-    QFileSystemModelPrivate::QFileSystemNode *dirNode = d->node(index);
+    QString path;
+    return d->resolvedFilePath(d->node(index), path);
+}
+
+/*!
+    \internal
+
+    Returns the path of \a dirNode, with symbolic links to directories
+    resolved. \a path holds the unresolved path if it was already built,
+    see data().
+*/
+QString QFileSystemModelPrivate::resolvedFilePath(const QFileSystemNode *dirNode, QString &path) const
+{
+    if (path.isNull())
+        path = filePath(dirNode);
+    const QString &fullPath = path;
     if (dirNode->isSymLink()
 #if QT_CONFIG(filesystemwatcher)
-        && d->fileInfoGatherer->resolveSymlinks()
+        && fileInfoGatherer->resolveSymlinks()
 #endif
-        && d->resolvedSymLinks.contains(fullPath)
+        && resolvedSymLinks.contains(fullPath)
         && dirNode->isDir()) {
         QFileInfo fullPathInfo(dirNode->fileInfo());
         if (!dirNode->hasInformation())
             fullPathInfo = QFileInfo(fullPath);
         QString canonicalPath = fullPathInfo.canonicalFilePath();
-        auto *canonicalNode = d->node(fullPathInfo.canonicalFilePath(), false);
+        auto *canonicalNode = node(fullPathInfo.canonicalFilePath(), false);
         QFileInfo resolvedInfo = canonicalNode->fileInfo();
         if (!canonicalNode->hasInformation())
             resolvedInfo = QFileInfo(canonicalPath);
@@ -1426,19 +2086,64 @@ QString QFileSystemModelPrivate::filePath(const QModelIndex &index) const
         return QString();
     Q_ASSERT(index.model() == q);
 
-    QStringList path;
-    QModelIndex idx = index;
-    while (idx.isValid()) {
-        QFileSystemModelPrivate::QFileSystemNode *dirNode = node(idx);
-        if (dirNode)
-            path.prepend(dirNode->fileName);
-        idx = idx.parent();
+    return filePath(node(index));
+}
+
+/*!
+    \internal
+
+    Returns the path of \a node. The path of its parent directory is kept
+    around between calls, so fetching the path of every row in a directory
+    is linear in the size of the output.
+*/
+QString QFileSystemModelPrivate::filePath(const QFileSystemNode *node) const
+{
+    if (!node || node == &root)
+        return QString();
+    const QFileSystemNode *parentNode = node->parent;
+    if (!parentNode || parentNode == &root)
+        return buildFilePath(node);
+
+    if (parentNode != filePathPrefixNode) {
+        filePathPrefix = buildFilePath(parentNode);
+        filePathPrefixNode = parentNode;
     }
-    QString fullPath = QDir::fromNativeSeparators(path.join(QDir::separator()));
-#if !defined(Q_OS_WIN)
-    if ((fullPath.size() > 2) && fullPath[0] == u'/' && fullPath[1] == u'/')
-        fullPath = fullPath.mid(1);
-#else
+    const bool needsSeparator = !filePathPrefix.endsWith(u'/');
+    QString fullPath;
+    fullPath.reserve(filePathPrefix.size() + 1 + node->fileName.size());
+    fullPath.append(filePathPrefix);
+    if (needsSeparator)
+        fullPath.append(u'/');
+    fullPath.append(node->fileName);
+    return fullPath;
+}
+
+/*!
+    \internal
+
+    Builds the path of \a node from the parent pointers, sizing the result
+    up front so that it is filled in a single allocation.
+*/
+QString QFileSystemModelPrivate::buildFilePath(const QFileSystemNode *node) const
+{
+    QVarLengthArray<const QFileSystemNode *, 32> chain;
+    qsizetype length = 0;
+    for (const QFileSystemNode *n = node; n && n != &root; n = n->parent) {
+        chain.append(n);
+        length += n->fileName.size() + 1;
+    }
+
+    QString fullPath;
+    fullPath.reserve(length + 1);
+    for (auto it = chain.crbegin(), end = chain.crend(); it != end; ++it) {
+        // the "/" element on Unix already ends with a separator
+        if (!fullPath.isEmpty() && !fullPath.endsWith(u'/'))
+            fullPath.append(u'/');
+        fullPath.append((*it)->fileName);
+    }
+#if defined(Q_OS_WIN)
+    // UNC hosts are stored with native separators
+    fullPath = QDir::fromNativeSeparators(fullPath);
     if (fullPath.length() == 2 && fullPath.endsWith(u':'))
         fullPath.append(u'/');
 #endif
@@ -1470,6 +2175,7 @@ QModelIndex QFileSystemModel::mkdir(const QModelIndex &parent, const QString &na
     QFileSystemModelPrivate::QFileSystemNode *node = parentNode->children[fileName];
 #if QT_CONFIG(filesystemwatcher)
     node->populate(d->fileInfoGatherer->getInfo(QFileInfo(dir.absolutePath() + QDir::separator() + fileName)));
+    d->syncEntry(parentNode, node);
 #endif
     d->addVisibleFiles(parentNode, QStringList(fileName));
     return d->index(node);
@@ -1544,7 +2250,9 @@ QModelIndex QFileSystemModel::setRootPath(const QString &newPath)
         //This line "marks" the node as dirty, so the next fetchMore
         //call on the path will ask the gatherer to install a watcher again
         //But it doesn't re-fetch everything
-        d->node(rootPath())->populatedChildren = false;
+        QFileSystemModelPrivate::QFileSystemNode *oldRoot = d->node(rootPath());
+        oldRoot->populatedChildren = false;
+        d->invalidatePublished(oldRoot);
     }
 
     // We have a new valid root path
@@ -1593,11 +2301,13 @@ QDir QFileSystemModel::rootDirectory() const
 */
 void QFileSystemModel::setIconProvider(QAbstractFileIconProvider *provider)
 {
-    Q_D(QFileSystemModel);
 #if QT_CONFIG(filesystemwatcher)
+    Q_D(QFileSystemModel);
     d->fileInfoGatherer->setIconProvider(provider);
+    d->invalidateDecorations();
+#else
+    Q_UNUSED(provider);
 #endif
-    d->root.updateIcon(provider, QString());
 }
 
 /*!
@@ -1630,7 +2340,8 @@ void QFileSystemModel::setFilter(QDir::Filters filters)
         filters.testFlag(QDir::CaseSensitive) != d->filters.testFlag(QDir::CaseSensitive);
     d->filters = filters;
     if (changingCaseSensitivity)
-        d->rebuildNameFilterRegexps();
+        d->rebuildNameFilterMatcher();
+    d->updateFilterPredicate();
     d->forceSort = true;
     d->delayedSort();
 }
@@ -1712,6 +2423,7 @@ void QFileSystemModel::setNameFilterDisables(bool enable)
     if (d->nameFilterDisables == enable)
         return;
     d->nameFilterDisables = enable;
+    d->updateFilterPredicate();
     d->forceSort = true;
     d->delayedSort();
 }
@@ -1722,6 +2434,32 @@ bool QFileSystemModel::nameFilterDisables() const
     return d->nameFilterDisables;
 }
 
+/*!
+    \internal
+
+    Makes the nodes that were shown regardless of the filters subject to them
+    again, but for the directories that must be kept around: rootPath and the
+    ones holding persistent indexes. Only those are marked again, everything
+    else is unmarked in O(1) by starting a new generation.
+*/
+void QFileSystemModelPrivate::clearBypassFilters()
+{
+    Q_Q(QFileSystemModel);
+    if (!hasBypassedNodes)
+        return;
+    ++bypassGeneration;
+    hasBypassedNodes = false;
+    // We guarantee that rootPath will stick around
+    const QPersistentModelIndex rootIndex(q->index(rootDir.path()));
+    const QModelIndexList persistentList = q->persistentIndexList();
+    for (const auto &persistentIndex : persistentList) {
+        for (QFileSystemNode *n = node(persistentIndex); n && !bypassesFilters(n); n = n->parent) {
+            if (n->isDir())
+                setBypassFilters(n);
+        }
+    }
+}
+
 /*!
     Sets the name \a filters to apply against the existing files.
 */
@@ -1730,26 +2468,11 @@ void QFileSystemModel::setNameFilters(const QStringList &filters)
 #if QT_CONFIG(regularexpression)
     Q_D(QFileSystemModel);
 
-    if (!d->bypassFilters.isEmpty()) {
-        // update the bypass filter to only bypass the stuff that must be kept around
-        d->bypassFilters.clear();
-        // We guarantee that rootPath will stick around
-        QPersistentModelIndex root(index(rootPath()));
-        const QModelIndexList persistentList = persistentIndexList();
-        for (const auto &persistentIndex : persistentList) {
-            QFileSystemModelPrivate::QFileSystemNode *node = d->node(persistentIndex);
-            while (node) {
-                if (d->bypassFilters.contains(node))
-                    break;
-                if (node->isDir())
-                    d->bypassFilters[node] = true;
-                node = node->parent;
-            }
-        }
-    }
+    d->clearBypassFilters();
 
     d->nameFilters = filters;
-    d->rebuildNameFilterRegexps();
+    d->rebuildNameFilterMatcher();
+    d->updateFilterPredicate();
     d->forceSort = true;
     d->delayedSort();
 #else
@@ -1771,209 +2494,1832 @@ QStringList QFileSystemModel::nameFilters() const
 }
 
 /*!
-    \reimp
+    \property QFileSystemModel::virtualizationThreshold
+    \brief the number of entries above which a directory is virtualized
+    \since 6.10
+
+    A virtualized directory only keeps the name, size, modification time and
+    attributes of each of its files. The complete information, including the
+    icon and the type, is gathered when an index for the file is requested,
+    and is released again once no view needs it. This bounds the memory used
+    by directories with a very large number of files to what the views show.
+
+    Sorting by type in a virtualized directory orders the files by suffix
+    rather than by the type reported by the icon provider.
+
+    The threshold only applies to directories loaded after it was set. Views
+    should use uniform item sizes (see QTreeView::uniformRowHeights) so that
+    they do not request an index for every row.
+
+    The default value is 0, which disables virtualization.
 */
-bool QFileSystemModel::event(QEvent *event)
+void QFileSystemModel::setVirtualizationThreshold(int entries)
 {
-#if QT_CONFIG(filesystemwatcher)
     Q_D(QFileSystemModel);
-    if (event->type() == QEvent::LanguageChange) {
-        d->root.retranslateStrings(d->fileInfoGatherer->iconProvider(), QString());
-        return true;
-    }
-#endif
-    return QAbstractItemModel::event(event);
+    d->virtualizationThreshold = qMax(0, entries);
 }
 
-bool QFileSystemModel::rmdir(const QModelIndex &aindex)
+int QFileSystemModel::virtualizationThreshold() const
 {
-    Q_D(QFileSystemModel);
-
-    QString path = filePath(aindex);
-    const bool success = QDir().rmdir(path);
-    if (success) {
-#if QT_CONFIG(filesystemwatcher)
-        d->fileInfoGatherer->removePath(path);
-#endif
-        QFileSystemModelPrivate::QFileSystemNode *parentNode = d->node(aindex.parent());
-        d->removeNode(parentNode, fileName(aindex));
-    }
-    return success;
+    Q_D(const QFileSystemModel);
+    return d->virtualizationThreshold;
 }
 
 /*!
-     \internal
+    \property QFileSystemModel::memoryBudget
+    \brief the number of bytes the model may use for the files it has loaded
+    \since 6.10
+
+    When memoryUsage() exceeds the budget, the model frees the children of
+    the directories that were used least recently, until the usage drops
+    to three quarters of the budget. A directory is only freed if none of
+    the files below it are referenced by a persistent index, which includes
+    the expanded and selected items of the views, and if it is neither the
+    root path nor one of its parents. Freed directories are listed again
+    the next time fetchMore() is called on them.
+
+    The default value is 0, which means that the model keeps everything it
+    has loaded.
+
+    \sa memoryUsage(), nodeCount()
+*/
+void QFileSystemModel::setMemoryBudget(qint64 bytes)
+{
+    Q_D(QFileSystemModel);
+    d->memoryBudget = qMax<qint64>(0, bytes);
+    d->evictionRetryBytes = 0;
+    if (d->memoryBudget > 0 && d->nodeBytes > d->memoryBudget)
+        d->evictionTimer.start(0, this);
+}
 
-    Performed quick listing and see if any files have been added or removed,
-    then fetch more information on visible files.
- */
-void QFileSystemModelPrivate::directoryChanged(const QString &directory, const QStringList &files)
+qint64 QFileSystemModel::memoryBudget() const
 {
-    QFileSystemModelPrivate::QFileSystemNode *parentNode = node(directory, false);
-    if (parentNode->children.size() == 0)
-        return;
-    QStringList toRemove;
-    QStringList newFiles = files;
-    std::sort(newFiles.begin(), newFiles.end());
-    for (auto i = parentNode->children.constBegin(), cend = parentNode->children.constEnd(); i != cend; ++i) {
-        QStringList::iterator iterator = std::lower_bound(newFiles.begin(), newFiles.end(), i.value()->fileName);
-        if ((iterator == newFiles.end()) || (i.value()->fileName < *iterator))
-            toRemove.append(i.value()->fileName);
-    }
-    for (int i = 0 ; i < toRemove.size() ; ++i )
-        removeNode(parentNode, toRemove[i]);
+    Q_D(const QFileSystemModel);
+    return d->memoryBudget;
 }
 
-#if defined(Q_OS_WIN)
-static QString volumeName(const QString &path)
+/*!
+    \since 6.10
+
+    Returns the number of files and directories the model currently holds.
+
+    \sa memoryUsage()
+*/
+qint64 QFileSystemModel::nodeCount() const
 {
-    IShellItem *item = nullptr;
-    const QString native = QDir::toNativeSeparators(path);
-    HRESULT hr = SHCreateItemFromParsingName(reinterpret_cast<const wchar_t *>(native.utf16()),
-                                             nullptr, IID_IShellItem,
-                                             reinterpret_cast<void **>(&item));
-    if (FAILED(hr))
-        return QString();
-    LPWSTR name = nullptr;
-    hr = item->GetDisplayName(SIGDN_NORMALDISPLAY, &name);
-    if (FAILED(hr))
-        return QString();
-    QString result = QString::fromWCharArray(name);
-    CoTaskMemFree(name);
-    item->Release();
-    return result;
+    Q_D(const QFileSystemModel);
+    return d->nodeCount;
 }
-#endif // Q_OS_WIN
 
 /*!
-    \internal
+    \since 6.10
 
-    Adds a new file to the children of parentNode
+    Returns an estimate of the number of bytes used by the files and
+    directories the model currently holds.
 
-    *WARNING* this will change the count of children
+    \sa memoryBudget, nodeCount()
 */
-QFileSystemModelPrivate::QFileSystemNode* QFileSystemModelPrivate::addNode(QFileSystemNode *parentNode, const QString &fileName, const QFileInfo& info)
+qint64 QFileSystemModel::memoryUsage() const
 {
-    // In the common case, itemLocation == count() so check there first
-    QFileSystemModelPrivate::QFileSystemNode *node = new QFileSystemModelPrivate::QFileSystemNode(fileName, parentNode);
-#if QT_CONFIG(filesystemwatcher)
-    node->populate(info);
-#else
-    Q_UNUSED(info);
-#endif
-#if defined(Q_OS_WIN)
-    //The parentNode is "" so we are listing the drives
-    if (parentNode->fileName.isEmpty())
-        node->volumeName = volumeName(fileName);
-#endif
-    Q_ASSERT(!parentNode->children.contains(fileName));
-    parentNode->children.insert(fileName, node);
-    return node;
+    Q_D(const QFileSystemModel);
+    return d->nodeBytes;
 }
 
 /*!
-    \internal
+    \since 6.10
 
-    File at parentNode->children(itemLocation) has been removed, remove from the lists
-    and emit signals if necessary
+    Returns the indexes of the loaded files and directories whose name
+    contains \a text, compared case insensitively. At most \a limit indexes
+    are returned, all of them if \a limit is negative.
 
-    *WARNING* this will change the count of children and could change visibleChildren
- */
-void QFileSystemModelPrivate::removeNode(QFileSystemModelPrivate::QFileSystemNode *parentNode, const QString& name)
+    Only the files the model has already loaded are searched, in any
+    directory, and only those that are not hidden by the filters, along
+    with all their parents. The indexes are in no particular order.
+
+    The first search builds an index of the names of the loaded files, which
+    is then kept up to date as files are added, renamed and removed, so
+    that later searches take time proportional to the number of matches
+    rather than to the number of loaded files. Searching for fewer than
+    three characters does not use the index.
+
+    \sa index()
+*/
+QModelIndexList QFileSystemModel::search(const QString &text, int limit) const
 {
-    Q_Q(QFileSystemModel);
-    QModelIndex parent = index(parentNode);
-    bool indexHidden = isHiddenByFilter(parentNode, parent);
+    Q_D(const QFileSystemModel);
+    if (text.isEmpty() || limit == 0)
+        return {};
+    QFileSystemModelPrivate *p = const_cast<QFileSystemModelPrivate *>(d);
+    if (!d->searchIndex)
+        p->buildSearchIndex();
+
+    // Creating the nodes of virtualized directories changes the index, so
+    // collect the matches first.
+    using Item = QFileSystemModelPrivate::SearchIndex::Item;
+    const QList<Item> items = d->searchIndex->find(text);
+    QList<Item> matches;
+    for (const Item &item : items) {
+        bool visible = false;
+        if (const auto *child = item.parent->children.value(item.fileName))
+            visible = child->isVisible;
+        else if (item.parent->entries)
+            visible = item.parent->entries->value(item.fileName).isVisible;
+        for (const auto *n = item.parent; visible && n != &d->root; n = n->parent)
+            visible = n->isVisible;
+        if (!visible)
+            continue;
+        matches.append(item);
+        if (limit > 0 && matches.size() == limit)
+            break;
+    }
 
-    int vLocation = parentNode->visibleLocation(name);
-    if (vLocation >= 0 && !indexHidden)
-        q->beginRemoveRows(parent, translateVisibleLocation(parentNode, vLocation),
-                                       translateVisibleLocation(parentNode, vLocation));
-    QFileSystemNode * node = parentNode->children.take(name);
-    delete node;
-    // cleanup sort files after removing rather then re-sorting which is O(n)
-    if (vLocation >= 0)
-        parentNode->visibleChildren.removeAt(vLocation);
-    if (vLocation >= 0 && !indexHidden)
-        q->endRemoveRows();
+    QModelIndexList result;
+    result.reserve(matches.size());
+    for (const Item &item : std::as_const(matches)) {
+        auto *parentNode = const_cast<QFileSystemModelPrivate::QFileSystemNode *>(item.parent);
+        if (const auto *child = d->childNode(parentNode, item.fileName))
+            result.append(d->index(child));
+    }
+    return result;
 }
 
+static constexpr char snapshotMagic[8] = { 'Q', 'F', 'S', 'M', 'S', 'N', 'A', 'P' };
+
 /*!
-    \internal
+    \since 6.10
 
-    File at parentNode->children(itemLocation) was not visible before, but now should be
-    and emit signals if necessary.
+    Writes the files and directories the model has loaded to \a fileName:
+    their names, kinds, sizes, modification times and permissions, and
+    which directories have been listed completely. Returns \c true on
+    success.
 
-    *WARNING* this will change the visible count
- */
-void QFileSystemModelPrivate::addVisibleFiles(QFileSystemNode *parentNode, const QStringList &newFiles)
+    The file is meant to be mapped in memory by loadSnapshot(), on a
+    machine with the same byte order.
+
+    \sa loadSnapshot()
+*/
+bool QFileSystemModel::saveSnapshot(const QString &fileName) const
 {
-    Q_Q(QFileSystemModel);
-    QModelIndex parent = index(parentNode);
-    bool indexHidden = isHiddenByFilter(parentNode, parent);
-    if (!indexHidden) {
-        q->beginInsertRows(parent, parentNode->visibleChildren.size() , parentNode->visibleChildren.size() + newFiles.size() - 1);
+    Q_D(const QFileSystemModel);
+    using Node = QFileSystemModelPrivate::QFileSystemNode;
+    using Record = QFileSystemModelPrivate::SnapshotRecord;
+
+    // Breadth first, so that the children of every record are consecutive
+    QList<Record> records = { Record{} };
+    QString names;
+    QList<std::pair<qsizetype, const Node *>> directories = { { 0, &d->root } };
+    for (qsizetype i = 0; i < directories.size(); ++i) {
+        const auto [recordIndex, n] = directories.at(i);
+        QList<Node::Entry> children;
+        if (n->entries) {
+            children = n->entries->values();
+        } else {
+            children.reserve(n->children.size());
+            for (const Node *child : std::as_const(n->children))
+                children.append(child->toEntry());
+        }
+        std::sort(children.begin(), children.end(), [](const Node::Entry &l, const Node::Entry &r) {
+            return l.fileName < r.fileName;
+        });
+        if (records.size() + children.size() > std::numeric_limits<quint32>::max())
+            return false;
+
+        Record &record = records[recordIndex];
+        record.firstChild = quint32(records.size());
+        record.childCount = quint32(children.size());
+        if (n->populatedChildren && n->listed)
+            record.flags |= QFileSystemModelPrivate::SnapshotPopulated;
+        for (const Node::Entry &entry : std::as_const(children)) {
+            Record child = {};
+            child.size = entry.size;
+            child.lastModified = entry.lastModified;
+            child.nameOffset = quint32(names.size());
+            child.nameLength = quint32(entry.fileName.size());
+            child.attributes = entry.attributes;
+            names.append(entry.fileName);
+            records.append(child);
+            const Node *childNode = n->children.value(entry.fileName);
+            if (childNode && (!childNode->children.isEmpty() || childNode->entries
+                              || childNode->populatedChildren)) {
+                directories.append({ records.size() - 1, childNode });
+            }
+        }
+        if (names.size() > std::numeric_limits<quint32>::max())
+            return false;
     }
 
-    if (parentNode->dirtyChildrenIndex == -1)
-        parentNode->dirtyChildrenIndex = parentNode->visibleChildren.size();
+    QFileSystemModelPrivate::SnapshotHeader header = {};
+    memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+    header.version = QFileSystemModelPrivate::SnapshotVersion;
+    header.byteOrder = QFileSystemModelPrivate::SnapshotByteOrder;
+    header.recordCount = quint32(records.size());
+    header.nameLength = quint32(names.size());
 
-    for (const auto &newFile : newFiles) {
-        parentNode->visibleChildren.append(newFile);
-        parentNode->children.value(newFile)->isVisible = true;
+#if QT_CONFIG(temporaryfile)
+    QSaveFile file(fileName);
+#else
+    QFile file(fileName);
+#endif
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    const qint64 recordBytes = records.size() * qint64(sizeof(Record));
+    const qint64 nameBytes = names.size() * qint64(sizeof(char16_t));
+    if (file.write(reinterpret_cast<const char *>(&header), sizeof(header)) != qint64(sizeof(header))
+        || file.write(reinterpret_cast<const char *>(records.constData()), recordBytes) != recordBytes
+        || file.write(reinterpret_cast<const char *>(names.utf16()), nameBytes) != nameBytes) {
+        return false;
     }
-    if (!indexHidden)
-      q->endInsertRows();
+#if QT_CONFIG(temporaryfile)
+    return file.commit();
+#else
+    return true;
+#endif
 }
 
 /*!
-    \internal
+    \since 6.10
 
-    File was visible before, but now should NOT be
+    Maps the snapshot written by saveSnapshot() to \a fileName in memory,
+    and returns \c true if it is valid. It replaces the snapshot loaded
+    before, if any.
 
-    *WARNING* this will change the visible count
- */
-void QFileSystemModelPrivate::removeVisibleFile(QFileSystemNode *parentNode, int vLocation)
+    From then on, fetchMore() takes the children of a directory from the
+    snapshot if the directory had been listed completely when the snapshot
+    was saved, instead of listing it. Only the records of the directories
+    that are fetched are read. The files are created as compact entries,
+    as in a virtualized directory, and the file system is only asked about
+    a file when a view requests its index. The directories loaded from the
+    snapshot are not watched for changes.
+
+    Call this function before setRootPath(): the directories the model has
+    already listed are not affected.
+
+    \sa saveSnapshot(), virtualizationThreshold
+*/
+bool QFileSystemModel::loadSnapshot(const QString &fileName)
 {
-    Q_Q(QFileSystemModel);
-    if (vLocation == -1)
-        return;
-    QModelIndex parent = index(parentNode);
-    bool indexHidden = isHiddenByFilter(parentNode, parent);
-    if (!indexHidden)
-        q->beginRemoveRows(parent, translateVisibleLocation(parentNode, vLocation),
-                                       translateVisibleLocation(parentNode, vLocation));
-    parentNode->children.value(parentNode->visibleChildren.at(vLocation))->isVisible = false;
-    parentNode->visibleChildren.removeAt(vLocation);
-    if (!indexHidden)
-        q->endRemoveRows();
+    Q_D(QFileSystemModel);
+    using Header = QFileSystemModelPrivate::SnapshotHeader;
+    auto file = std::make_unique<QFile>(fileName);
+    if (!file->open(QIODevice::ReadOnly))
+        return false;
+    const qint64 size = file->size();
+    if (size < qint64(sizeof(Header)))
+        return false;
+    const uchar *data = file->map(0, size);
+    if (!data)
+        return false;
+
+    const Header *header = reinterpret_cast<const Header *>(data);
+    const qint64 expectedSize = qint64(sizeof(Header))
+            + header->recordCount * qint64(sizeof(QFileSystemModelPrivate::SnapshotRecord))
+            + header->nameLength * qint64(sizeof(char16_t));
+    if (memcmp(header->magic, snapshotMagic, sizeof(snapshotMagic)) != 0
+        || header->version != QFileSystemModelPrivate::SnapshotVersion
+        || header->byteOrder != QFileSystemModelPrivate::SnapshotByteOrder
+        || header->recordCount == 0 || size != expectedSize) {
+        return false;
+    }
+    d->snapshotFile = std::move(file);
+    d->snapshotData = data;
+    return true;
 }
 
 /*!
-    \internal
+    \since 6.10
 
-    The thread has received new information about files,
-    update and emit dataChanged if it has actually changed.
- */
-void QFileSystemModelPrivate::fileSystemChanged(const QString &path,
-                                                   const QList<std::pair<QString, QFileInfo>> &updates)
+    Returns an immutable copy of the files and directories the model has
+    loaded, which can be passed to and queried from other threads while the
+    model keeps changing.
+
+    The directories whose children did not change since the previous call
+    are shared with the previously published tree, so the cost of this
+    function is proportional to the number of directories that changed.
+
+    This is unrelated to saveSnapshot(), which writes the tree to a file.
+
+    \sa QFileSystemModelTree
+*/
+QFileSystemModelTree QFileSystemModel::publishedTree() const
 {
-#if QT_CONFIG(filesystemwatcher)
-    Q_Q(QFileSystemModel);
-    QList<QString> rowsToUpdate;
-    QStringList newFiles;
-    QFileSystemModelPrivate::QFileSystemNode *parentNode = node(path, false);
-    QModelIndex parentIndex = index(parentNode);
-    for (const auto &update : updates) {
-        QString fileName = update.first;
-        Q_ASSERT(!fileName.isEmpty());
-        QExtendedInformation info = fileInfoGatherer->getInfo(update.second);
-        bool previouslyHere = parentNode->children.contains(fileName);
-        if (!previouslyHere) {
-#ifdef Q_OS_WIN
-            chopSpaceAndDot(fileName);
-            if (fileName.isEmpty())
-                continue;
+    Q_D(const QFileSystemModel);
+    auto *root = const_cast<QFileSystemModelPrivate::QFileSystemNode *>(&d->root);
+    if (!root->published)
+        ++d->publishedVersion;
+    return QFileSystemModelTree(new QFileSystemModelTreePrivate(d->publish(root),
+                                                                d->publishedVersion));
+}
+
+/*!
+    \class QFileSystemModelTree
+    \inmodule QtGui
+    \since 6.10
+    \brief The QFileSystemModelTree class is an immutable copy of the
+    files loaded by a QFileSystemModel.
+
+    \reentrant
+    \ingroup shared
+
+    A tree is published with QFileSystemModel::publishedTree(). It holds the
+    names, sizes, modification times and permissions of the files and
+    directories the model had loaded at that time, and does not change
+    afterwards. Trees can be copied and queried from any thread without
+    locking, which allows worker threads to look files up without going
+    through the thread of the model or accessing the file system.
+
+    Paths are resolved like QFileSystemModel::index() does, but without
+    accessing the file system: files the model had not loaded are reported
+    as not existing.
+*/
+
+/*!
+    \fn void QFileSystemModelTree::swap(QFileSystemModelTree &other)
+    \memberswap{tree}
+*/
+
+/*!
+    \fn bool QFileSystemModelTree::isNull() const
+
+    Returns \c true if this tree was default constructed.
+*/
+
+/*!
+    \fn QFileSystemModelTree::QFileSystemModelTree(QFileSystemModelTree &&other)
+
+    Move-constructs a tree from \a other, which is null afterwards.
+*/
+
+/*!
+    Constructs a null tree, in which no file exists.
+*/
+QFileSystemModelTree::QFileSystemModelTree() noexcept = default;
+
+/*!
+    Constructs a copy of \a other.
+*/
+QFileSystemModelTree::QFileSystemModelTree(const QFileSystemModelTree &other) noexcept
+    : d(other.d)
+{
+    if (d)
+        d->ref.ref();
+}
+
+/*!
+    Assigns \a other to this tree.
+*/
+QFileSystemModelTree &QFileSystemModelTree::operator=(const QFileSystemModelTree &other) noexcept
+{
+    if (other.d)
+        other.d->ref.ref();
+    if (d && !d->ref.deref())
+        delete d;
+    d = other.d;
+    return *this;
+}
+
+/*!
+    Destroys the tree.
+*/
+QFileSystemModelTree::~QFileSystemModelTree()
+{
+    if (d && !d->ref.deref())
+        delete d;
+}
+
+/*!
+    Returns the version of the tree. Two trees of the same model with the
+    same version hold the same files; a tree with a higher version was
+    published after the model changed.
+*/
+quint64 QFileSystemModelTree::version() const noexcept
+{
+    return d ? d->version : 0;
+}
+
+static inline const QFileSystemModelTreeDirectory *rootOf(const QFileSystemModelTreePrivate *d)
+{
+    return d ? d->root.data() : nullptr;
+}
+
+/*!
+    \internal
+
+    Returns the file at \a path below \a root, or \nullptr if there is none.
+    The path elements are split the same way as in QFileSystemModelPrivate::node().
+*/
+static const QFileSystemModelTreeDirectory::File *
+findPublishedFile(const QFileSystemModelTreeDirectory *root, const QString &path)
+{
+    if (!root || path.isEmpty())
+        return nullptr;
+    const QString absolutePath = QDir::cleanPath(QDir::isAbsolutePath(path)
+            ? QDir::fromNativeSeparators(path) : QDir(path).absolutePath());
+    QStringList elements = absolutePath.split(u'/', Qt::SkipEmptyParts);
+#if defined(Q_OS_WIN)
+    if (absolutePath.startsWith("//"_L1) && !elements.isEmpty())
+        elements.first().prepend("\\"_L1);
+#else
+    if (absolutePath.startsWith(u'/'))
+        elements.prepend("/"_L1);
+#endif
+
+    const QFileSystemModelTreeDirectory *directory = root;
+    const QFileSystemModelTreeDirectory::File *file = nullptr;
+    for (const QString &element : std::as_const(elements)) {
+        if (!directory)
+            return nullptr;
+        const auto it = directory->files.constFind(element);
+        if (it == directory->files.cend())
+            return nullptr;
+        file = &*it;
+        directory = file->directory.data();
+    }
+    return file;
+}
+
+/*!
+    Returns \c true if the model had loaded the file or directory at \a path.
+*/
+bool QFileSystemModelTree::exists(const QString &path) const
+{
+    return findPublishedFile(rootOf(d), path);
+}
+
+/*!
+    Returns \c true if \a path is a directory.
+*/
+bool QFileSystemModelTree::isDir(const QString &path) const
+{
+    const auto *file = findPublishedFile(rootOf(d), path);
+    return file && file->isDir;
+}
+
+/*!
+    Returns \c true if all the children of the directory at \a path had been
+    loaded, in which case entryList() returns all of them.
+*/
+bool QFileSystemModelTree::isListed(const QString &path) const
+{
+    const auto *file = findPublishedFile(rootOf(d), path);
+    return file && file->directory && file->directory->listed;
+}
+
+/*!
+    Returns the size of the file at \a path, as QFileSystemModel::size()
+    would have returned it, or 0 if it does not exist.
+*/
+qint64 QFileSystemModelTree::size(const QString &path) const
+{
+    const auto *file = findPublishedFile(rootOf(d), path);
+    return file ? qMax<qint64>(0, file->size) : 0;
+}
+
+/*!
+    Returns the time of the last modification of the file at \a path, in
+    UTC, or an invalid QDateTime if it does not exist.
+*/
+QDateTime QFileSystemModelTree::lastModified(const QString &path) const
+{
+    const auto *file = findPublishedFile(rootOf(d), path);
+    return file ? QDateTime::fromMSecsSinceEpoch(file->lastModified, QTimeZone::UTC) : QDateTime();
+}
+
+/*!
+    Returns the permissions of the file at \a path. Files that were not
+    loaded with all their information only report the permissions of the
+    current user.
+*/
+QFile::Permissions QFileSystemModelTree::permissions(const QString &path) const
+{
+    const auto *file = findPublishedFile(rootOf(d), path);
+    return file ? file->permissions : QFile::Permissions();
+}
+
+/*!
+    Returns the names of the loaded children of the directory at \a path, in
+    no particular order. An empty \a path lists the drives, or the root
+    directory.
+
+    \sa isListed()
+*/
+QStringList QFileSystemModelTree::entryList(const QString &path) const
+{
+    const QFileSystemModelTreeDirectory *directory = rootOf(d);
+    if (!path.isEmpty()) {
+        const auto *file = findPublishedFile(rootOf(d), path);
+        directory = file ? file->directory.data() : nullptr;
+    }
+    QStringList result;
+    if (!directory)
+        return result;
+    result.reserve(directory->files.size());
+    for (const auto &file : directory->files)
+        result.append(file.fileName);
+    return result;
+}
+
+/*!
+    \reimp
+*/
+bool QFileSystemModel::event(QEvent *event)
+{
+    Q_D(QFileSystemModel);
+    if (event->type() == QEvent::LanguageChange) {
+        ++d->localeGeneration;
+#if QT_CONFIG(filesystemwatcher)
+        d->invalidateDecorations();
+#endif
+        return true;
+    }
+    return QAbstractItemModel::event(event);
+}
+
+bool QFileSystemModel::rmdir(const QModelIndex &aindex)
+{
+    Q_D(QFileSystemModel);
+
+    QString path = filePath(aindex);
+    const bool success = QDir().rmdir(path);
+    if (success) {
+#if QT_CONFIG(filesystemwatcher)
+        d->fileInfoGatherer->removePath(path);
+#endif
+        QFileSystemModelPrivate::QFileSystemNode *parentNode = d->node(aindex.parent());
+        d->removeNode(parentNode, fileName(aindex));
+    }
+    return success;
+}
+
+/*!
+     \internal
+
+    Performed quick listing and see if any files have been added or removed,
+    then fetch more information on visible files.
+ */
+void QFileSystemModelPrivate::directoryChanged(const QString &directory, const QStringList &files)
+{
+    QFileSystemModelPrivate::QFileSystemNode *parentNode = node(directory, false);
+    if (parentNode->children.size() == 0 && !parentNode->entries)
+        return;
+    // Same key type as children, so names are compared the way the file system does
+    const QSet<QFileSystemModelNodePathKey> listed(files.cbegin(), files.cend());
+    QStringList toRemove;
+    if (parentNode->entries) {
+        // every child of a virtualized directory has an entry
+        for (const QFileSystemNode::Entry &entry : std::as_const(*parentNode->entries)) {
+            if (!listed.contains(entry.fileName))
+                toRemove.append(entry.fileName);
+        }
+    } else {
+        for (const QFileSystemNode *child : std::as_const(parentNode->children)) {
+            if (!listed.contains(child->fileName))
+                toRemove.append(child->fileName);
+        }
+    }
+    removeNodes(parentNode, toRemove);
+}
+
+#if defined(Q_OS_WIN)
+static QString volumeName(const QString &path)
+{
+    IShellItem *item = nullptr;
+    const QString native = QDir::toNativeSeparators(path);
+    HRESULT hr = SHCreateItemFromParsingName(reinterpret_cast<const wchar_t *>(native.utf16()),
+                                             nullptr, IID_IShellItem,
+                                             reinterpret_cast<void **>(&item));
+    if (FAILED(hr))
+        return QString();
+    LPWSTR name = nullptr;
+    hr = item->GetDisplayName(SIGDN_NORMALDISPLAY, &name);
+    if (FAILED(hr))
+        return QString();
+    QString result = QString::fromWCharArray(name);
+    CoTaskMemFree(name);
+    item->Release();
+    return result;
+}
+#endif // Q_OS_WIN
+
+/*!
+    \internal
+
+    Adds a new file to the children of parentNode
+
+    *WARNING* this will change the count of children
+*/
+QFileSystemModelPrivate::QFileSystemNode* QFileSystemModelPrivate::addNode(QFileSystemNode *parentNode, const QString &fileName, const QFileInfo& info)
+{
+    // In the common case, itemLocation == count() so check there first
+    QFileSystemModelPrivate::QFileSystemNode *node = new QFileSystemModelPrivate::QFileSystemNode(fileName, parentNode);
+#if QT_CONFIG(filesystemwatcher)
+    node->populate(info);
+#else
+    Q_UNUSED(info);
+#endif
+    return insertNode(parentNode, node);
+}
+
+/*!
+    \internal
+
+    Adds a node for the \a entry of a virtualized \a parentNode. The node has
+    the filter attributes of the entry, but no information until the
+    gatherer reported it.
+*/
+QFileSystemModelPrivate::QFileSystemNode *QFileSystemModelPrivate::addNode(QFileSystemNode *parentNode,
+                                                                           const QFileSystemNode::Entry &entry)
+{
+    QFileSystemNode *node = new QFileSystemNode(entry.fileName, parentNode);
+    node->attributes = entry.attributes;
+    node->isVisible = entry.isVisible;
+    return insertNode(parentNode, node);
+}
+
+/*!
+    \internal
+
+    Makes \a node, which was just created, a child of \a parentNode.
+*/
+QFileSystemModelPrivate::QFileSystemNode *QFileSystemModelPrivate::insertNode(QFileSystemNode *parentNode,
+                                                                              QFileSystemNode *node)
+{
+    const QString &fileName = node->fileName;
+#if QT_CONFIG(filesystemwatcher)
+    node->decorationGeneration = decorationGeneration;
+#endif
+#if defined(Q_OS_WIN)
+    //The parentNode is "" so we are listing the drives
+    if (parentNode->fileName.isEmpty())
+        node->volumeName = volumeName(fileName);
+#endif
+    Q_ASSERT(!parentNode->children.contains(fileName));
+    parentNode->children.insert(nameKey(fileName), node);
+    if (parentNode->entries && !parentNode->entries->contains(fileName))
+        syncEntry(parentNode, node);
+    invalidatePublished(parentNode);
+    if (searchIndex)
+        searchIndex->insert(parentNode, fileName);
+    ++nodeCount;
+    nodeBytes += nodeFootprint(node);
+    scheduleEviction();
+    return node;
+}
+
+/*!
+    \internal
+
+    Evicts nodes on the next iteration of the event loop if nodeBytes has
+    grown over the memory budget.
+*/
+void QFileSystemModelPrivate::scheduleEviction()
+{
+    if (memoryBudget > 0 && nodeBytes > qMax(memoryBudget, evictionRetryBytes)
+        && !evictionTimer.isActive()) {
+        Q_Q(QFileSystemModel);
+        evictionTimer.start(0, q);
+    }
+}
+
+/*!
+    \internal
+
+    File at parentNode->children(itemLocation) has been removed, remove from the lists
+    and emit signals if necessary
+
+    *WARNING* this will change the count of children and could change visibleChildren
+ */
+void QFileSystemModelPrivate::removeNode(QFileSystemModelPrivate::QFileSystemNode *parentNode, const QString& name)
+{
+    Q_Q(QFileSystemModel);
+    QModelIndex parent = index(parentNode);
+    bool indexHidden = isHiddenByFilter(parentNode, parent);
+
+    if (computeDirectorySizes) {
+        const auto [size, items] = directorySizeShare(parentNode, name);
+        adjustDirectorySizes(parentNode, -size, -items);
+    }
+
+    int vLocation = parentNode->visibleLocation(name);
+    if (vLocation >= 0 && !indexHidden)
+        q->beginRemoveRows(parent, translateVisibleLocation(parentNode, vLocation),
+                                       translateVisibleLocation(parentNode, vLocation));
+    QFileSystemNode * node = parentNode->children.take(name);
+    if (parentNode->entries)
+        removeEntry(parentNode, name);
+    invalidatePublished(parentNode);
+    if (searchIndex)
+        searchIndex->remove(parentNode, name);
+    if (node) {
+        forgetNodes(node);
+        releaseNodes(node);
+    }
+    delete node;
+    // cleanup sort files after removing rather then re-sorting which is O(n)
+    if (vLocation >= 0) {
+        parentNode->visibleChildren.removeAt(vLocation);
+        parentNode->updateVisibleRows(vLocation);
+    }
+    if (vLocation >= 0 && !indexHidden)
+        q->endRemoveRows();
+}
+
+/*!
+    \internal
+
+    Same as calling removeNode() for each of \a names, but the rows are
+    removed with one signal per contiguous range.
+
+    *WARNING* this will change the count of children and could change visibleChildren
+ */
+void QFileSystemModelPrivate::removeNodes(QFileSystemNode *parentNode, const QStringList &names)
+{
+    if (names.isEmpty())
+        return;
+    if (names.size() == 1) {
+        removeNode(parentNode, names.constFirst());
+        return;
+    }
+
+    if (computeDirectorySizes) {
+        qint64 size = 0;
+        qint64 items = 0;
+        for (const QString &name : names) {
+            const auto share = directorySizeShare(parentNode, name);
+            size += share.first;
+            items += share.second;
+        }
+        adjustDirectorySizes(parentNode, -size, -items);
+    }
+
+    removeVisibleFiles(parentNode, names);
+    invalidatePublished(parentNode);
+    for (const QString &name : names) {
+        QFileSystemNode *node = parentNode->children.take(name);
+        if (parentNode->entries)
+            removeEntry(parentNode, name);
+        if (searchIndex)
+            searchIndex->remove(parentNode, name);
+        if (node) {
+            forgetNodes(node);
+            releaseNodes(node);
+        }
+        delete node;
+    }
+}
+
+/*!
+    \internal
+
+    Removes the children at the visible locations \a vLocations from the
+    visible children of \a parentNode. Locations that are next to each other
+    in the view are removed together, with one beginRemoveRows() and
+    endRemoveRows() pair per range.
+
+    *WARNING* this will change the visible count
+ */
+void QFileSystemModelPrivate::removeVisibleChildren(QFileSystemNode *parentNode,
+                                                    const QList<int> &vLocations)
+{
+    Q_Q(QFileSystemModel);
+    if (vLocations.isEmpty())
+        return;
+    const QModelIndex parent = index(parentNode);
+    const bool indexHidden = isHiddenByFilter(parentNode, parent);
+
+    QList<int> rows;
+    rows.reserve(vLocations.size());
+    for (int vLocation : vLocations)
+        rows.append(translateVisibleLocation(parentNode, vLocation));
+    std::sort(rows.begin(), rows.end());
+
+    // In descending order, the rows before dirtyChildrenIndex are mirrored
+    // while the others are not, so a range must not span both.
+    const auto mirrored = [this, parentNode](int row) {
+        return sortOrder != Qt::AscendingOrder && parentNode->dirtyChildrenIndex != -1
+            && row < parentNode->dirtyChildrenIndex;
+    };
+
+    // Remove the last range first, so that the rows before it stay valid
+    int firstMoved = parentNode->visibleChildren.size();
+    qsizetype end = rows.size();
+    while (end > 0) {
+        qsizetype begin = end - 1;
+        while (begin > 0 && rows.at(begin - 1) == rows.at(begin) - 1
+               && mirrored(rows.at(begin - 1)) == mirrored(rows.at(begin))) {
+            --begin;
+        }
+        const int firstRow = rows.at(begin);
+        const int lastRow = rows.at(end - 1);
+        const int v1 = translateVisibleLocation(parentNode, firstRow);
+        const int v2 = translateVisibleLocation(parentNode, lastRow);
+        const int first = qMin(v1, v2);
+        const int count = qAbs(v2 - v1) + 1;
+
+        if (!indexHidden)
+            q->beginRemoveRows(parent, firstRow, lastRow);
+        for (int i = first; i < first + count; ++i)
+            setChildVisible(parentNode, parentNode->visibleChildren.at(i), false);
+        parentNode->visibleChildren.remove(first, count);
+        firstMoved = qMin(firstMoved, first);
+        if (parentNode->dirtyChildrenIndex > first)
+            parentNode->dirtyChildrenIndex -= qMin(count, parentNode->dirtyChildrenIndex - first);
+        if (!indexHidden)
+            q->endRemoveRows();
+        end = begin;
+    }
+    parentNode->updateVisibleRows(firstMoved);
+}
+
+/*!
+    \internal
+
+    Returns the child \a name of \a parentNode. In a virtualized directory the
+    node is created from its entry the first time it is asked for, otherwise
+    \nullptr is returned if there is no such child.
+*/
+QFileSystemModelPrivate::QFileSystemNode *QFileSystemModelPrivate::childNode(QFileSystemNode *parentNode,
+                                                                             const QString &name) const
+{
+    if (QFileSystemNode *child = lookupChild(parentNode, name))
+        return child;
+    if (!parentNode->entries)
+        return nullptr;
+    auto it = parentNode->entries->constFind(name);
+    if (it == parentNode->entries->cend() && caseInsensitiveNames
+        && !QFileSystemModelNodePathKey::DefaultCaseInsensitive) {
+        it = parentNode->entries->constFind(QFileSystemModelNodePathKey(name, true));
+    }
+    if (it == parentNode->entries->cend())
+        return nullptr;
+
+    // The entry has what the filters and sorting need, the rest of the
+    // information is fetched in the background like for any new file
+    QFileSystemModelPrivate *p = const_cast<QFileSystemModelPrivate *>(this);
+    QFileSystemModel *q = const_cast<QFileSystemModel *>(q_func());
+    QFileSystemNode *child = p->addNode(parentNode, *it);
+#if QT_CONFIG(filesystemwatcher)
+    QString dir = !toFetch.isEmpty() && toFetch.constLast().node->parent == parentNode
+            ? toFetch.constLast().dir : filePath(parentNode);
+    p->toFetch.append({ std::move(dir), child->fileName, child });
+    p->fetchingTimer.start(0, q);
+#endif
+
+    if (parentNode->children.size() > VirtualNodeLimit && !trimCandidates.contains(parentNode)) {
+        p->trimCandidates.insert(parentNode);
+        if (!trimTimer.isActive())
+            p->trimTimer.start(TrimInterval, q);
+    }
+    return child;
+}
+
+/*!
+    \internal
+
+    Turns \a parentNode into a virtualized directory: from now on it keeps a
+    compact entry for every child, and nodes only for the children that have
+    been asked for.
+*/
+void QFileSystemModelPrivate::virtualize(QFileSystemNode *parentNode)
+{
+    Q_Q(QFileSystemModel);
+    Q_ASSERT(!parentNode->entries);
+    parentNode->entries = std::make_unique<QHash<QFileSystemModelNodePathKey, QFileSystemNode::Entry>>();
+    parentNode->entries->reserve(parentNode->children.size());
+    for (const QFileSystemNode *child : std::as_const(parentNode->children))
+        insertEntry(parentNode, child->toEntry());
+
+    if (parentNode->children.size() > VirtualNodeLimit) {
+        trimCandidates.insert(parentNode);
+        if (!trimTimer.isActive())
+            trimTimer.start(TrimInterval, q);
+    }
+}
+
+/*!
+    \internal
+
+    Updates the entry of \a node if \a parentNode is virtualized, and
+    drops the published children of \a parentNode.
+*/
+void QFileSystemModelPrivate::syncEntry(QFileSystemNode *parentNode, const QFileSystemNode *node)
+{
+    invalidatePublished(parentNode);
+    // a node made from its entry has nothing newer until it is populated
+    if (parentNode->entries && node->hasInformation())
+        insertEntry(parentNode, node->toEntry());
+}
+
+/*!
+    \internal
+
+    Drops every reference to \a node and its descendants, which are about to
+    be deleted.
+*/
+void QFileSystemModelPrivate::forgetNodes(const QFileSystemNode *node)
+{
+    toFetch.removeIf([node](const Fetching &fetching) {
+        const QFileSystemNode *n = fetching.node;
+        while (n && n != node)
+            n = n->parent;
+        return n != nullptr;
+    });
+    for (auto it = trimCandidates.begin(); it != trimCandidates.end();) {
+        const QFileSystemNode *candidate = *it;
+        while (candidate && candidate != node)
+            candidate = candidate->parent;
+        if (candidate)
+            it = trimCandidates.erase(it);
+        else
+            ++it;
+    }
+    if (searchIndex) {
+        QList<const QFileSystemNode *> pending = { node };
+        while (!pending.isEmpty()) {
+            const QFileSystemNode *n = pending.takeLast();
+            searchIndex->removeChildren(n);
+            for (const QFileSystemNode *child : std::as_const(n->children)) {
+                if (!child->children.isEmpty() || child->entries)
+                    pending.append(child);
+            }
+        }
+    }
+    invalidatePathCaches();
+}
+
+/*!
+    \internal
+
+    Deletes the least recently used nodes of the virtualized directories
+    that went over VirtualNodeLimit, down to that limit, if they can be
+    recreated from their entries: nodes that have no children, are not
+    referenced by a persistent index and are not waiting for information.
+    The rows a view shows were asked for last, so they are kept. The views
+    may still hold plain indexes of the deleted nodes, so each trimmed
+    directory changes its layout; that is why this runs at most once every
+    TrimInterval ms.
+*/
+void QFileSystemModelPrivate::trimVirtualDirectories()
+{
+    Q_Q(QFileSystemModel);
+    QSet<const QFileSystemNode *> pinned;
+    const QModelIndexList persistentList = q->persistentIndexList();
+    for (const QModelIndex &persistentIndex : persistentList) {
+        for (const QFileSystemNode *n = node(persistentIndex); n && !pinned.contains(n); n = n->parent)
+            pinned.insert(n);
+    }
+    for (const Fetching &fetching : std::as_const(toFetch))
+        pinned.insert(fetching.node);
+
+    const QSet<QFileSystemNode *> candidates = std::exchange(trimCandidates, {});
+    for (QFileSystemNode *parentNode : candidates) {
+        if (!parentNode->entries || parentNode->children.size() <= VirtualNodeLimit)
+            continue;
+        QList<QFileSystemNode *> unused;
+        for (QFileSystemNode *child : std::as_const(parentNode->children)) {
+            if (child->children.isEmpty() && !child->entries && !pinned.contains(child)
+                && !bypassesFilters(child)) {
+                unused.append(child);
+            }
+        }
+        const qsizetype excess = parentNode->children.size() - VirtualNodeLimit;
+        if (unused.size() > excess) {
+            std::nth_element(unused.begin(), unused.begin() + excess, unused.end(),
+                             [](const QFileSystemNode *l, const QFileSystemNode *r) {
+                return l->lastUsed < r->lastUsed;
+            });
+            unused.resize(excess);
+        }
+        if (unused.isEmpty())
+            continue;
+
+        // Rows don't move, but plain model indexes of the deleted nodes dangle
+        const QList<QPersistentModelIndex> parents = { index(parentNode) };
+        emit q->layoutAboutToBeChanged(parents);
+        for (QFileSystemNode *child : std::as_const(unused)) {
+            syncEntry(parentNode, child);
+            parentNode->children.remove(child->fileName);
+            releaseNodes(child);
+            delete child;
+        }
+        invalidatePathCaches();
+        emit q->layoutChanged(parents);
+    }
+}
+
+/*!
+    \internal
+
+    Adds the child \a fileName of \a parent, unless it is already there.
+*/
+void QFileSystemModelPrivate::SearchIndex::insert(const QFileSystemNode *parent,
+                                                  const QString &fileName)
+{
+    auto &children = itemsByParent[parent];
+    if (children.contains(fileName))
+        return;
+    const quint32 id = quint32(items.size());
+    items.append({ parent, fileName });
+    children.insert(fileName, id);
+    addPostings(id);
+}
+
+void QFileSystemModelPrivate::SearchIndex::remove(const QFileSystemNode *parent,
+                                                  const QString &fileName)
+{
+    const auto it = itemsByParent.find(parent);
+    if (it == itemsByParent.end())
+        return;
+    const auto child = it->constFind(fileName);
+    if (child == it->cend())
+        return;
+    items[*child] = {};
+    ++removedCount;
+    it->erase(child);
+    if (it->isEmpty())
+        itemsByParent.erase(it);
+    compact();
+}
+
+/*!
+    \internal
+
+    Removes all the children of \a parent, which is about to be deleted or
+    to lose its children.
+*/
+void QFileSystemModelPrivate::SearchIndex::removeChildren(const QFileSystemNode *parent)
+{
+    const auto children = itemsByParent.take(parent);
+    for (const quint32 id : children)
+        items[id] = {};
+    removedCount += children.size();
+    compact();
+}
+
+/*!
+    \internal
+
+    Returns the items whose name contains \a text, compared case
+    insensitively. Candidates are taken from the rarest trigram of \a text
+    and then compared in full; shorter texts are compared with every item.
+*/
+QList<QFileSystemModelPrivate::SearchIndex::Item>
+QFileSystemModelPrivate::SearchIndex::find(const QString &text) const
+{
+    const QString folded = text.toCaseFolded();
+    const QList<quint32> *candidates = nullptr;
+    for (qsizetype i = 0; i + 3 <= folded.size(); ++i) {
+        const auto it = postings.constFind(trigram(folded, i));
+        if (it == postings.cend())
+            return {};
+        if (!candidates || it->size() < candidates->size())
+            candidates = &*it;
+    }
+
+    QList<Item> result;
+    const auto match = [&](const Item &item) {
+        if (item.parent && item.fileName.contains(text, Qt::CaseInsensitive))
+            result.append(item);
+    };
+    if (candidates) {
+        for (const quint32 id : *candidates)
+            match(items.at(id));
+    } else {
+        for (const Item &item : items)
+            match(item);
+    }
+    return result;
+}
+
+void QFileSystemModelPrivate::SearchIndex::addPostings(quint32 id)
+{
+    const QString folded = items.at(id).fileName.toCaseFolded();
+    for (qsizetype i = 0; i + 3 <= folded.size(); ++i) {
+        // ids only grow, so a repeated trigram of the same name is the last one
+        QList<quint32> &ids = postings[trigram(folded, i)];
+        if (ids.isEmpty() || ids.constLast() != id)
+            ids.append(id);
+    }
+}
+
+/*!
+    \internal
+
+    Removed items are only cleared, and stay in the postings. Once they
+    outnumber the others, the items are packed and the postings rebuilt.
+*/
+void QFileSystemModelPrivate::SearchIndex::compact()
+{
+    if (removedCount < 1024 || removedCount < items.size() - removedCount)
+        return;
+
+    QList<Item> live;
+    live.reserve(items.size() - removedCount);
+    for (Item &item : items) {
+        if (item.parent)
+            live.append(std::move(item));
+    }
+    items = std::move(live);
+    removedCount = 0;
+    postings.clear();
+    itemsByParent.clear();
+    for (quint32 id = 0; id < quint32(items.size()); ++id) {
+        itemsByParent[items.at(id).parent].insert(items.at(id).fileName, id);
+        addPostings(id);
+    }
+}
+
+/*!
+    \internal
+
+    Creates the search index from the nodes and entries loaded so far.
+*/
+void QFileSystemModelPrivate::buildSearchIndex()
+{
+    searchIndex = std::make_unique<SearchIndex>();
+    QList<const QFileSystemNode *> pending = { &root };
+    while (!pending.isEmpty()) {
+        const QFileSystemNode *n = pending.takeLast();
+        for (const QFileSystemNode *child : std::as_const(n->children)) {
+            searchIndex->insert(n, child->fileName);
+            if (!child->children.isEmpty() || child->entries)
+                pending.append(child);
+        }
+        if (n->entries) {
+            for (const QFileSystemNode::Entry &entry : std::as_const(*n->entries))
+                searchIndex->insert(n, entry.fileName);
+        }
+    }
+}
+
+/*!
+    \internal
+
+    Makes the lookups of children by name ignore case, or not. The keys of
+    the children never change: files whose names only differ in case all
+    stay in the model, and a lookup prefers the one of the exact name.
+*/
+void QFileSystemModelPrivate::setCaseInsensitiveNames(bool enable)
+{
+    if (caseInsensitiveNames == enable)
+        return;
+    caseInsensitiveNames = enable;
+    // the cached paths may have been resolved the other way
+    invalidatePathCaches();
+}
+
+/*!
+    \internal
+
+    Returns the record \a i of the snapshot, or \nullptr if there is no
+    such record or if it points outside of the snapshot.
+*/
+const QFileSystemModelPrivate::SnapshotRecord *QFileSystemModelPrivate::snapshotRecord(quint32 i) const
+{
+    const auto *header = reinterpret_cast<const SnapshotHeader *>(snapshotData);
+    if (!header || i >= header->recordCount)
+        return nullptr;
+    const auto *record = reinterpret_cast<const SnapshotRecord *>(snapshotData + sizeof(SnapshotHeader)) + i;
+    if (quint64(record->nameOffset) + record->nameLength > header->nameLength
+        || quint64(record->firstChild) + record->childCount > header->recordCount) {
+        return nullptr;
+    }
+    return record;
+}
+
+QStringView QFileSystemModelPrivate::snapshotName(const SnapshotRecord *record) const
+{
+    const auto *header = reinterpret_cast<const SnapshotHeader *>(snapshotData);
+    const auto *names = reinterpret_cast<const char16_t *>(
+            snapshotData + sizeof(SnapshotHeader) + header->recordCount * sizeof(SnapshotRecord));
+    return QStringView(names + record->nameOffset, record->nameLength);
+}
+
+/*!
+    \internal
+
+    Returns the record of the snapshot for \a node, following the names of
+    its parents from the root record, or \nullptr if there is none.
+*/
+const QFileSystemModelPrivate::SnapshotRecord *
+QFileSystemModelPrivate::findSnapshotRecord(const QFileSystemNode *node) const
+{
+    QList<const QFileSystemNode *> chain;
+    for (; node && node != &root; node = node->parent)
+        chain.append(node);
+    if (!node)
+        return nullptr;
+
+    const SnapshotRecord *record = snapshotRecord(0);
+    for (qsizetype i = chain.size() - 1; record && i >= 0; --i) {
+        const QString &name = chain.at(i)->fileName;
+        quint32 first = record->firstChild;
+        quint32 count = record->childCount;
+        // lower bound of name among the children
+        while (count > 0) {
+            const quint32 step = count / 2;
+            const SnapshotRecord *child = snapshotRecord(first + step);
+            if (!child)
+                return nullptr;
+            if (snapshotName(child) < QStringView(name)) {
+                first += step + 1;
+                count -= step + 1;
+            } else {
+                count = step;
+            }
+        }
+        record = first < record->firstChild + record->childCount ? snapshotRecord(first) : nullptr;
+        if (record && snapshotName(record) != QStringView(name))
+            record = nullptr;
+    }
+    return record;
+}
+
+/*!
+    \internal
+
+    Creates the children of \a node from the snapshot, as the entries of a
+    virtualized directory, if the snapshot has all of them. Returns \c false
+    if the directory has to be listed instead.
+*/
+bool QFileSystemModelPrivate::populateFromSnapshot(QFileSystemNode *node)
+{
+    Q_Q(QFileSystemModel);
+    if (node == &root)
+        return false;
+    const SnapshotRecord *record = findSnapshotRecord(node);
+    if (!record || !(record->flags & SnapshotPopulated))
+        return false;
+
+    if (!node->entries)
+        virtualize(node);
+    QStringList newFiles;
+    for (quint32 i = 0; i < record->childCount; ++i) {
+        const SnapshotRecord *childRecord = snapshotRecord(record->firstChild + i);
+        if (!childRecord || childRecord->nameLength == 0)
+            continue;
+        QFileSystemNode::Entry entry;
+        entry.fileName = snapshotName(childRecord).toString();
+        entry.size = childRecord->size;
+        entry.lastModified = childRecord->lastModified;
+        entry.attributes = childRecord->attributes;
+        auto it = node->entries->find(entry.fileName);
+        if (it == node->entries->end()) {
+            if (searchIndex)
+                searchIndex->insert(node, entry.fileName);
+            it = insertEntry(node, std::move(entry));
+        }
+        if (!it->isVisible && filtersAcceptsEntry(node, *it))
+            newFiles.append(it->fileName);
+    }
+    if (!newFiles.isEmpty())
+        addVisibleFiles(node, newFiles);
+    node->listed = true;
+    invalidatePublished(node);
+    forceSort = true;
+    delayedSort();
+
+    // as if the gatherer had listed it
+    QMetaObject::invokeMethod(q, [q, path = filePath(node)] {
+        emit q->directoryLoaded(path);
+    }, Qt::QueuedConnection);
+    return true;
+}
+
+/*!
+    \internal
+
+    Returns the published children of \a node, copying those that changed
+    since they were last published.
+*/
+QExplicitlySharedDataPointer<QFileSystemModelTreeDirectory>
+QFileSystemModelPrivate::publish(QFileSystemNode *node) const
+{
+    if (node->published)
+        return node->published;
+
+    using File = QFileSystemModelTreeDirectory::File;
+    QExplicitlySharedDataPointer<QFileSystemModelTreeDirectory> directory(
+            new QFileSystemModelTreeDirectory);
+    directory->listed = node->populatedChildren && (node->listed || node == &root);
+    const auto publishChild = [&](const QString &fileName) -> File & {
+        File &file = directory->files[nameKey(fileName)];
+        file.fileName = fileName;
+        QFileSystemNode *child = node->children.value(fileName);
+        if (child && (!child->children.isEmpty() || child->entries || child->populatedChildren))
+            file.directory = publish(child);
+        return file;
+    };
+    const auto fromAttributes = [](quint16 attributes) {
+        QFile::Permissions permissions;
+        if (attributes & QFileSystemNode::Readable)
+            permissions |= QFile::ReadUser;
+        if (attributes & QFileSystemNode::Writable)
+            permissions |= QFile::WriteUser;
+        if (attributes & QFileSystemNode::Executable)
+            permissions |= QFile::ExeUser;
+        return permissions;
+    };
+
+    directory->files.reserve(node->entries ? node->entries->size() : node->children.size());
+    if (node->entries) {
+        for (const QFileSystemNode::Entry &entry : std::as_const(*node->entries)) {
+            File &file = publishChild(entry.fileName);
+            file.size = entry.size;
+            file.lastModified = entry.lastModified;
+            file.permissions = fromAttributes(entry.attributes);
+            file.isDir = entry.attributes & QFileSystemNode::Dir;
+        }
+    }
+    for (const QFileSystemNode *child : std::as_const(node->children)) {
+        if (node->entries && node->entries->contains(child->fileName) && !child->hasInformation())
+            continue;
+        File &file = publishChild(child->fileName);
+        file.size = child->sortSize();
+        file.lastModified = child->lastModified(QTimeZone::UTC).toMSecsSinceEpoch();
+        file.permissions = child->hasInformation() ? child->permissions()
+                                                   : fromAttributes(child->attributes);
+        file.isDir = child->isDir();
+    }
+    node->published = directory;
+    return directory;
+}
+
+/*!
+    \internal
+
+    Returns the estimated number of bytes used by \a node, without its
+    children: the node, its information, its name and its slot in the
+    children of its parent.
+*/
+qint64 QFileSystemModelPrivate::nodeFootprint(const QFileSystemNode *node)
+{
+    constexpr qint64 fixed = sizeof(QFileSystemNode) + sizeof(QExtendedInformation)
+                           + sizeof(QFileSystemModelNodePathKey) + sizeof(QFileSystemNode *)
+                           + sizeof(QString);
+    return fixed + node->fileName.size() * qint64(sizeof(QChar));
+}
+
+/*!
+    \internal
+
+    Returns the estimated number of bytes used by \a entry in the entries of
+    a virtualized directory.
+*/
+qint64 QFileSystemModelPrivate::entryFootprint(const QFileSystemNode::Entry &entry)
+{
+    constexpr qint64 fixed = sizeof(QFileSystemNode::Entry) + sizeof(QFileSystemModelNodePathKey);
+    return fixed + entry.fileName.size() * qint64(sizeof(QChar));
+}
+
+/*!
+    \internal
+
+    Adds \a entry to the entries of \a parentNode, or replaces the entry of
+    the same name, and counts it in nodeBytes.
+*/
+QHash<QFileSystemModelNodePathKey, QFileSystemModelPrivate::QFileSystemNode::Entry>::iterator
+QFileSystemModelPrivate::insertEntry(QFileSystemNode *parentNode, QFileSystemNode::Entry entry)
+{
+    Q_ASSERT(parentNode->entries);
+    auto it = parentNode->entries->find(nameKey(entry.fileName));
+    if (it != parentNode->entries->end()) {
+        nodeBytes += entryFootprint(entry) - entryFootprint(*it);
+        *it = std::move(entry);
+        return it;
+    }
+    nodeBytes += entryFootprint(entry);
+    scheduleEviction();
+    return parentNode->entries->insert(nameKey(entry.fileName), std::move(entry));
+}
+
+/*!
+    \internal
+
+    Removes the entry \a name from the entries of \a parentNode.
+*/
+void QFileSystemModelPrivate::removeEntry(QFileSystemNode *parentNode, const QString &name)
+{
+    const auto it = parentNode->entries->find(name);
+    if (it == parentNode->entries->end())
+        return;
+    nodeBytes -= entryFootprint(*it);
+    parentNode->entries->erase(it);
+}
+
+/*!
+    \internal
+
+    Deletes all the entries of \a node, which is no longer virtualized.
+*/
+void QFileSystemModelPrivate::releaseEntries(QFileSystemNode *node)
+{
+    if (!node->entries)
+        return;
+    for (const QFileSystemNode::Entry &entry : std::as_const(*node->entries))
+        nodeBytes -= entryFootprint(entry);
+    node->entries.reset();
+}
+
+/*!
+    \internal
+
+    Removes \a node and its descendants, which are about to be deleted, from
+    nodeCount and nodeBytes. The objects returned by mimeData() that refer
+    to any of them are detached first, while their nodes still exist.
+*/
+void QFileSystemModelPrivate::releaseNodes(const QFileSystemNode *node)
+{
+    if (!lazyMimeData.isEmpty())
+        detachMimeData(node);
+    QList<const QFileSystemNode *> pending = { node };
+    while (!pending.isEmpty()) {
+        const QFileSystemNode *n = pending.takeLast();
+        for (const QFileSystemNode *child : std::as_const(n->children))
+            pending.append(child);
+        --nodeCount;
+        nodeBytes -= nodeFootprint(n);
+        if (n->entries) {
+            for (const QFileSystemNode::Entry &entry : std::as_const(*n->entries))
+                nodeBytes -= entryFootprint(entry);
+        }
+    }
+}
+
+/*!
+    \internal
+
+    Makes the objects returned by mimeData() that refer to \a subtree or to
+    its descendants, or all of them if \a subtree is \nullptr, build the
+    paths of their nodes now, and stop referring to the nodes, which are
+    about to be deleted.
+*/
+void QFileSystemModelPrivate::detachMimeData(const QFileSystemNode *subtree)
+{
+    const auto isInSubtree = [subtree](const QFileSystemNode *n) {
+        while (n && n != subtree)
+            n = n->parent;
+        return n != nullptr;
+    };
+    const QList<QFileSystemModelMimeData *> mimeData = lazyMimeData;
+    for (QFileSystemModelMimeData *data : mimeData) {
+        if (subtree && std::none_of(data->nodes.cbegin(), data->nodes.cend(), isInSubtree))
+            continue;
+        lazyMimeData.removeOne(data);
+        data->detach();
+    }
+}
+
+QFileSystemModelMimeData::QFileSystemModelMimeData(QFileSystemModelPrivate *model,
+                                                   QList<const QFileSystemNode *> nodes)
+    : model(model), nodes(std::move(nodes))
+{
+    model->lazyMimeData.append(this);
+}
+
+QFileSystemModelMimeData::~QFileSystemModelMimeData()
+{
+    if (model)
+        model->lazyMimeData.removeOne(this);
+}
+
+bool QFileSystemModelMimeData::hasFormat(const QString &mimeType) const
+{
+    return mimeType == "text/uri-list"_L1 || QMimeData::hasFormat(mimeType);
+}
+
+QStringList QFileSystemModelMimeData::formats() const
+{
+    QStringList result = QMimeData::formats();
+    if (!result.contains("text/uri-list"_L1))
+        result.prepend("text/uri-list"_L1);
+    return result;
+}
+
+/*!
+    \internal
+
+    Returns the URLs of the nodes, as a list of QUrl when \a type asks for
+    one, as in urls(), and otherwise encoded as a text/uri-list, which is
+    what platform drags ask for. The encoding is built line by line, without
+    a list of QUrl.
+*/
+QVariant QFileSystemModelMimeData::retrieveData(const QString &mimeType, QMetaType type) const
+{
+    if (mimeType != "text/uri-list"_L1 || QMimeData::hasFormat(mimeType))
+        return QMimeData::retrieveData(mimeType, type);
+
+    if (type.id() == QMetaType::QVariantList && uriList.isNull()) {
+        const QStringList filePaths = this->filePaths();
+        QVariantList urls;
+        urls.reserve(filePaths.size());
+        for (const QString &path : filePaths)
+            urls.append(QUrl::fromLocalFile(path));
+        return urls;
+    }
+    if (uriList.isNull()) {
+        const QStringList filePaths = this->filePaths();
+        uriList = ""_ba; // not null, even without nodes
+        for (const QString &path : filePaths) {
+            uriList += QUrl::fromLocalFile(path).toEncoded();
+            uriList += "\r\n";
+        }
+    }
+    return uriList;
+}
+
+/*!
+    \internal
+
+    Builds the paths of the nodes while they exist, called by the model
+    before it deletes nodes, and when it is destroyed.
+*/
+void QFileSystemModelMimeData::detach()
+{
+    if (uriList.isNull())
+        paths = filePaths();
+    nodes.clear();
+    model = nullptr;
+}
+
+QStringList QFileSystemModelMimeData::filePaths() const
+{
+    if (!model)
+        return paths;
+    QStringList result;
+    result.reserve(nodes.size());
+    for (const QFileSystemNode *node : nodes) {
+        QString path;
+        result.append(model->resolvedFilePath(node, path));
+    }
+    return result;
+}
+
+/*!
+    \internal
+
+    Frees the children and entries of the least recently used directories
+    until they fit in three quarters of the memory budget. Only subtrees without
+    persistent indexes, pending fetches or bypassed nodes are considered,
+    and never the root path or its ancestors.
+*/
+void QFileSystemModelPrivate::evictNodes()
+{
+    Q_Q(QFileSystemModel);
+    if (memoryBudget <= 0 || nodeBytes <= memoryBudget)
+        return;
+
+    QSet<const QFileSystemNode *> pinned;
+    const auto pin = [&pinned](const QFileSystemNode *n) {
+        for (; n && !pinned.contains(n); n = n->parent)
+            pinned.insert(n);
+    };
+    const QModelIndexList persistentList = q->persistentIndexList();
+    for (const QModelIndex &persistentIndex : persistentList)
+        pin(node(persistentIndex));
+    QList<const QFileSystemNode *> pending = { &root };
+    while (!pending.isEmpty()) {
+        const QFileSystemNode *n = pending.takeLast();
+        for (const QFileSystemNode *child : std::as_const(n->children)) {
+            if (bypassesFilters(child))
+                pin(child);
+            if (!child->children.isEmpty())
+                pending.append(child);
+        }
+    }
+    for (const Fetching &fetching : std::as_const(toFetch))
+        pin(fetching.node);
+    pin(node(rootDir.path(), false));
+    pin(&root);
+
+    // The candidates are the topmost unpinned directories that have children
+    // or entries, used as recently as the most recently used directory below
+    // them.
+    struct Candidate {
+        QFileSystemNode *node;
+        quint32 lastUsed;
+    };
+    const auto lastUsedBelow = [](const QFileSystemNode *n, const auto &self) -> quint32 {
+        quint32 lastUsed = n->lastUsed;
+        for (const QFileSystemNode *child : std::as_const(n->children)) {
+            if (!child->children.isEmpty() || child->entries)
+                lastUsed = qMax(lastUsed, self(child, self));
+        }
+        return lastUsed;
+    };
+    QList<Candidate> candidates;
+    pending = { &root };
+    while (!pending.isEmpty()) {
+        const QFileSystemNode *n = pending.takeLast();
+        for (QFileSystemNode *child : std::as_const(n->children)) {
+            if (pinned.contains(child))
+                pending.append(child);
+            else if (!child->children.isEmpty() || child->entries)
+                candidates.append({ child, lastUsedBelow(child, lastUsedBelow) });
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &l, const Candidate &r) {
+        return l.lastUsed < r.lastUsed;
+    });
+
+    const qint64 target = memoryBudget - memoryBudget / 4;
+    for (const Candidate &candidate : std::as_const(candidates)) {
+        if (nodeBytes <= target)
+            break;
+        evictChildren(candidate.node);
+    }
+    evictionRetryBytes = nodeBytes > memoryBudget ? nodeBytes + memoryBudget / 4 : 0;
+}
+
+/*!
+    \internal
+
+    Deletes all the children of \a node and marks it as not populated, so
+    that the next fetchMore() lists it again.
+*/
+void QFileSystemModelPrivate::evictChildren(QFileSystemNode *node)
+{
+    Q_Q(QFileSystemModel);
+    const QModelIndex parent = index(node);
+    const bool indexHidden = isHiddenByFilter(node, parent);
+    const int rows = node->visibleChildren.size();
+    if (rows > 0 && !indexHidden)
+        q->beginRemoveRows(parent, 0, rows - 1);
+
+#if QT_CONFIG(filesystemwatcher)
+    QStringList watched;
+    QList<const QFileSystemNode *> pending = { node };
+    while (!pending.isEmpty()) {
+        const QFileSystemNode *n = pending.takeLast();
+        if (n->populatedChildren)
+            watched.append(filePath(n));
+        for (const QFileSystemNode *child : std::as_const(n->children)) {
+            if (!child->children.isEmpty() || child->populatedChildren)
+                pending.append(child);
+        }
+    }
+#endif
+    forgetNodes(node);
+    for (const QFileSystemNode *child : std::as_const(node->children))
+        releaseNodes(child);
+    qDeleteAll(node->children);
+    node->children.clear();
+    node->visibleChildren.clear();
+    releaseEntries(node);
+    node->dirtyChildrenIndex = -1;
+    node->populatedChildren = false;
+    node->listed = false;
+    invalidatePublished(node);
+    invalidatePathCaches();
+
+    if (rows > 0 && !indexHidden)
+        q->endRemoveRows();
+#if QT_CONFIG(filesystemwatcher)
+    if (!watched.isEmpty())
+        fileInfoGatherer->unwatchPaths(watched);
+#endif
+}
+
+/*!
+    \internal
+
+    File at parentNode->children(itemLocation) was not visible before, but now should be
+    and emit signals if necessary.
+
+    *WARNING* this will change the visible count
+ */
+void QFileSystemModelPrivate::addVisibleFiles(QFileSystemNode *parentNode, const QStringList &newFiles)
+{
+    Q_Q(QFileSystemModel);
+    QModelIndex parent = index(parentNode);
+    bool indexHidden = isHiddenByFilter(parentNode, parent);
+    if (!indexHidden) {
+        q->beginInsertRows(parent, parentNode->visibleChildren.size() , parentNode->visibleChildren.size() + newFiles.size() - 1);
+    }
+
+    if (parentNode->dirtyChildrenIndex == -1)
+        parentNode->dirtyChildrenIndex = parentNode->visibleChildren.size();
+
+    for (const auto &newFile : newFiles) {
+        parentNode->visibleChildren.append(newFile);
+        setChildVisible(parentNode, newFile, true);
+    }
+    if (!indexHidden)
+      q->endInsertRows();
+}
+
+/*!
+    \internal
+
+    Files were visible before, but now should NOT be. The rows are removed
+    with one signal per contiguous range.
+
+    *WARNING* this will change the visible count
+ */
+void QFileSystemModelPrivate::removeVisibleFiles(QFileSystemNode *parentNode, const QStringList &names)
+{
+    if (names.isEmpty())
+        return;
+    const QSet<QString> removed(names.cbegin(), names.cend());
+    QList<int> vLocations;
+    for (qsizetype i = 0; i < parentNode->visibleChildren.size(); ++i) {
+        if (removed.contains(parentNode->visibleChildren.at(i)))
+            vLocations.append(int(i));
+    }
+    removeVisibleChildren(parentNode, vLocations);
+}
+
+/*!
+    \internal
+
+    Marks the child \a name of \a parentNode as (not) \a visible, on its node
+    and, in a virtualized directory, on its entry.
+ */
+void QFileSystemModelPrivate::setChildVisible(QFileSystemNode *parentNode, const QString &name,
+                                              bool visible)
+{
+    if (QFileSystemNode *child = parentNode->children.value(name))
+        child->isVisible = visible;
+    if (parentNode->entries) {
+        const auto it = parentNode->entries->find(name);
+        if (it != parentNode->entries->end())
+            it->isVisible = visible;
+    }
+}
+
+/*!
+    \internal
+
+    The thread has received new information about files,
+    update and emit dataChanged if it has actually changed.
+ */
+void QFileSystemModelPrivate::fileSystemChanged(const QString &path,
+                                                   const QList<std::pair<QString, QFileInfo>> &updates)
+{
+#if QT_CONFIG(filesystemwatcher)
+    Q_Q(QFileSystemModel);
+    QList<QString> rowsToUpdate;
+    QStringList newFiles;
+    QStringList filesToHide;
+    // changes to the recursive sizes of parentNode and its parents
+    qint64 sizeDelta = 0;
+    qint64 itemDelta = 0;
+    QFileSystemModelPrivate::QFileSystemNode *parentNode = node(path, false);
+    QModelIndex parentIndex = index(parentNode);
+    if (!parentNode->entries && virtualizationThreshold > 0 && parentNode != &root
+        && parentNode->children.size() + updates.size() > virtualizationThreshold) {
+        virtualize(parentNode);
+    }
+    invalidatePublished(parentNode);
+    for (const auto &update : updates) {
+        QString fileName = update.first;
+        Q_ASSERT(!fileName.isEmpty());
+        if (parentNode->entries && !parentNode->children.contains(fileName)) {
+            // Only keep the compact entry; the node, its icon and type are
+            // created when a view asks for the row.
+#ifdef Q_OS_WIN
+            chopSpaceAndDot(fileName);
+            if (fileName.isEmpty())
+                continue;
+#endif
+            QFileSystemNode::Entry entry = QFileSystemNode::entryFor(fileName, update.second);
+            const bool isDir = entry.attributes & QFileSystemNode::Dir;
+            auto it = parentNode->entries->find(fileName);
+            if (it == parentNode->entries->end()) {
+                if (parentNode->listed) {
+                    sizeDelta += isDir ? 0 : qMax<qint64>(0, entry.size);
+                    ++itemDelta;
+                }
+                it = insertEntry(parentNode, entry);
+                if (searchIndex)
+                    searchIndex->insert(parentNode, fileName);
+            } else {
+                if (isDir)
+                    entry.size = it->size; // keep the recursive size
+                if (it->sameMetaData(entry))
+                    continue;
+                if (!isDir && !(it->attributes & QFileSystemNode::Dir))
+                    sizeDelta += qMax<qint64>(0, entry.size) - qMax<qint64>(0, it->size);
+                entry.fileName = it->fileName;
+                entry.isVisible = it->isVisible;
+                *it = std::move(entry);
+            }
+            if (filtersAcceptsEntry(parentNode, *it)) {
+                if (!it->isVisible)
+                    newFiles.append(it->fileName);
+                else
+                    rowsToUpdate.append(it->fileName);
+            } else if (it->isVisible) {
+                filesToHide.append(it->fileName);
+            }
+            continue;
+        }
+        QExtendedInformation info = fileInfoGatherer->getInfo(update.second);
+        bool previouslyHere = parentNode->children.contains(fileName);
+        if (!previouslyHere) {
+#ifdef Q_OS_WIN
+            chopSpaceAndDot(fileName);
+            if (fileName.isEmpty())
+                continue;
 #endif
             addNode(parentNode, fileName, info.fileInfo());
         }
@@ -1988,13 +4334,33 @@ void QFileSystemModelPrivate::fileSystemChanged(const QString &path,
         }
         if (isCaseSensitive) {
             Q_ASSERT(node->fileName == fileName);
-        } else {
+        } else if (node->fileName != fileName) {
+            nodeBytes -= nodeFootprint(node);
             node->fileName = fileName;
+            nodeBytes += nodeFootprint(node);
+            invalidatePathCaches();
         }
 
         if (*node != info ) {
+            qint64 oldSize = previouslyHere ? qMax<qint64>(0, node->size()) : 0;
+            if (previouslyHere && !node->hasInformation() && parentNode->entries) {
+                // a node made from its entry, whose size was counted already
+                const auto it = parentNode->entries->constFind(fileName);
+                if (it != parentNode->entries->cend() && !(it->attributes & QFileSystemNode::Dir))
+                    oldSize = qMax<qint64>(0, it->size);
+            }
             node->populate(info);
-            bypassFilters.remove(node);
+            if (computeDirectorySizes) {
+                if (previouslyHere || parentNode->listed)
+                    sizeDelta += qMax<qint64>(0, node->size()) - oldSize;
+                if (!previouslyHere && parentNode->listed) {
+                    ++itemDelta;
+                    node->addSizeToParents = node->isDir();
+                }
+                requestDirectorySize(node);
+            }
+            syncEntry(parentNode, node);
+            node->bypassGeneration = 0;
             // brand new information.
             if (filtersAcceptsNode(node)) {
                 if (!node->isVisible) {
@@ -2004,8 +4370,7 @@ void QFileSystemModelPrivate::fileSystemChanged(const QString &path,
                 }
             } else {
                 if (node->isVisible) {
-                    int visibleLocation = parentNode->visibleLocation(fileName);
-                    removeVisibleFile(parentNode, visibleLocation);
+                    filesToHide.append(fileName);
                 } else {
                     // The file is not visible, don't do anything
                 }
@@ -2013,6 +4378,10 @@ void QFileSystemModelPrivate::fileSystemChanged(const QString &path,
         }
     }
 
+    removeVisibleFiles(parentNode, filesToHide);
+    if (computeDirectorySizes && (sizeDelta != 0 || itemDelta != 0))
+        adjustDirectorySizes(parentNode, sizeDelta, itemDelta);
+
     // bundle up all of the changed signals into as few as possible.
     std::sort(rowsToUpdate.begin(), rowsToUpdate.end());
     QString min;
@@ -2125,6 +4494,11 @@ QFileSystemModelPrivate::QFileSystemModelPrivate()
 
 QFileSystemModelPrivate::~QFileSystemModelPrivate()
 {
+    detachMimeData();
+#if QT_CONFIG(thread)
+    // cancels the file operations, and waits for them
+    fileOperations.reset();
+#endif
 #if QT_CONFIG(filesystemwatcher)
     fileInfoGatherer->requestAbort();
     if (!fileInfoGatherer->wait(1000)) {
@@ -2139,14 +4513,197 @@ QFileSystemModelPrivate::~QFileSystemModelPrivate()
 #endif // filesystemwatcher
 }
 
+/*!
+    \internal
+
+    Adds \a sizeDelta and \a itemDelta to the recursive sizes of \a parentNode
+    and of its parents, where they are known.
+*/
+void QFileSystemModelPrivate::adjustDirectorySizes(QFileSystemNode *parentNode, qint64 sizeDelta,
+                                                   qint64 itemDelta)
+{
+    Q_Q(QFileSystemModel);
+    for (QFileSystemNode *n = parentNode; n && n != &root; n = n->parent) {
+        if (n->totalSize < 0)
+            continue;
+        n->totalSize = qMax<qint64>(0, n->totalSize + sizeDelta);
+        n->totalItems = qMax<qint64>(0, n->totalItems + itemDelta);
+        syncEntry(n->parent, n);
+        const QModelIndex sizeIndex = index(n, SizeColumn);
+        if (sizeIndex.isValid())
+            emit q->dataChanged(sizeIndex, sizeIndex);
+    }
+}
+
+/*!
+    \internal
+
+    Returns the size and the number of items that the child \a name of
+    \a parentNode contributes to the recursive size of \a parentNode.
+*/
+std::pair<qint64, qint64> QFileSystemModelPrivate::directorySizeShare(const QFileSystemNode *parentNode,
+                                                                      const QString &name) const
+{
+    if (const QFileSystemNode *child = parentNode->children.value(name)) {
+        if (child->isDir())
+            return { qMax<qint64>(0, child->totalSize), 1 + qMax<qint64>(0, child->totalItems) };
+        return { qMax<qint64>(0, child->size()), 1 };
+    }
+    if (parentNode->entries) {
+        const auto it = parentNode->entries->constFind(name);
+        if (it != parentNode->entries->cend())
+            return { qMax<qint64>(0, it->size), 1 };
+    }
+    return { 0, 0 };
+}
+
+#if QT_CONFIG(filesystemwatcher)
+/*!
+    \internal
+
+    Turns the computation of recursive directory sizes on or off. Turning it
+    on requests the sizes of the directories in all the loaded directories.
+*/
+void QFileSystemModelPrivate::setComputeDirectorySizes(bool enable)
+{
+    if (computeDirectorySizes == enable)
+        return;
+    computeDirectorySizes = enable;
+    if (!enable) {
+        fileInfoGatherer->cancelDirectorySizes();
+        directorySizeCache.clear();
+    }
+
+    QList<QFileSystemNode *> pending = { &root };
+    while (!pending.isEmpty()) {
+        QFileSystemNode *n = pending.takeLast();
+        for (QFileSystemNode *child : std::as_const(n->children)) {
+            if (enable) {
+                if (n != &root && n->populatedChildren)
+                    requestDirectorySize(child);
+            } else {
+                child->totalSize = -1;
+                child->totalItems = -1;
+                child->sizePending = false;
+                child->addSizeToParents = false;
+                syncEntry(n, child);
+            }
+            if (!child->children.isEmpty())
+                pending.append(child);
+        }
+    }
+    if (!enable && sortColumn == SizeColumn) {
+        forceSort = true;
+        delayedSort();
+    }
+}
+
+/*!
+    \internal
+
+    Asks the gatherer for the recursive size of \a node if it is a directory
+    whose size is neither known nor already being computed with one of its
+    parents. Drives are never computed.
+*/
+void QFileSystemModelPrivate::requestDirectorySize(QFileSystemNode *node)
+{
+    if (!computeDirectorySizes || node->totalSize >= 0 || node->sizePending
+        || !node->parent || node->parent == &root || !node->isDir()) {
+        return;
+    }
+    const QString path = filePath(node);
+    if (QDirectorySize *cached = directorySizeCache.object(path)) {
+        node->totalSize = cached->size;
+        node->totalItems = cached->items;
+        directorySizeCache.remove(path);
+        syncEntry(node->parent, node);
+        return;
+    }
+    for (const QFileSystemNode *parent = node->parent; parent; parent = parent->parent) {
+        if (parent->sizePending)
+            return; // reported along with the parent
+    }
+    node->sizePending = true;
+    fileInfoGatherer->computeDirectorySize(path);
+}
+
+/*!
+    \internal
+
+    The gatherer computed the recursive \a sizes of \a directory and of the
+    directories below it.
+*/
+void QFileSystemModelPrivate::directorySizesComputed(const QString &directory,
+                                                     const QList<QDirectorySize> &sizes)
+{
+    Q_Q(QFileSystemModel);
+    if (!computeDirectorySizes)
+        return;
+    QFileSystemNode *directoryNode = loadedNode(directory);
+    if (!directoryNode || directoryNode == &root)
+        return;
+
+    for (const QDirectorySize &directorySize : sizes) {
+        QFileSystemNode *n = directoryNode;
+        for (const auto element : QStringView(directorySize.path).tokenize(u'/', Qt::SkipEmptyParts)) {
+            n = n->children.value(element.toString());
+            if (!n)
+                break;
+        }
+        if (!n) {
+            directorySizeCache.insert(directory + u'/' + directorySize.path,
+                                      new QDirectorySize(directorySize));
+            continue;
+        }
+
+        n->totalSize = directorySize.size;
+        n->totalItems = directorySize.items;
+        if (n == directoryNode)
+            n->sizePending = false;
+        if (n->addSizeToParents) {
+            n->addSizeToParents = false;
+            adjustDirectorySizes(n->parent, directorySize.size, directorySize.items);
+        }
+        syncEntry(n->parent, n);
+        const QModelIndex sizeIndex = index(n, SizeColumn);
+        if (sizeIndex.isValid())
+            emit q->dataChanged(sizeIndex, sizeIndex);
+    }
+
+    if (sortColumn == SizeColumn) {
+        forceSort = true;
+        delayedSort();
+    }
+}
+
+/*!
+    \internal
+
+    The first listing of \a path has been received, from now on new children
+    are files that were added.
+*/
+void QFileSystemModelPrivate::directoryListed(const QString &path)
+{
+    QFileSystemNode *n = loadedNode(path);
+    if (!n || n == &root)
+        return;
+    n->listed = true;
+    invalidatePublished(n);
+}
+#endif // filesystemwatcher
+
 /*!
     \internal
 */
 void QFileSystemModelPrivate::init()
 {
     delayedSortTimer.setSingleShot(true);
+    nodeCache.setMaxCost(NodeCacheSize);
+    directorySizeCache.setMaxCost(DirectorySizeCacheSize);
+    updateFilterPredicate();
 
     qRegisterMetaType<QList<std::pair<QString, QFileInfo>>>();
+    qRegisterMetaType<QList<QDirectorySize>>();
 #if QT_CONFIG(filesystemwatcher)
     QObjectPrivate::connect(fileInfoGatherer.get(), &QFileInfoGatherer::newListOfFiles,
                             this, &QFileSystemModelPrivate::directoryChanged);
@@ -2154,6 +4711,10 @@ void QFileSystemModelPrivate::init()
                             this, &QFileSystemModelPrivate::fileSystemChanged);
     QObjectPrivate::connect(fileInfoGatherer.get(), &QFileInfoGatherer::nameResolved,
                             this, &QFileSystemModelPrivate::resolvedName);
+    QObjectPrivate::connect(fileInfoGatherer.get(), &QFileInfoGatherer::directoryListed,
+                            this, &QFileSystemModelPrivate::directoryListed);
+    QObjectPrivate::connect(fileInfoGatherer.get(), &QFileInfoGatherer::directorySizes,
+                            this, &QFileSystemModelPrivate::directorySizesComputed);
     Q_Q(QFileSystemModel);
     q->connect(fileInfoGatherer.get(), &QFileInfoGatherer::directoryLoaded,
                q, &QFileSystemModel::directoryLoaded);
@@ -2163,6 +4724,101 @@ void QFileSystemModelPrivate::init()
                             Qt::QueuedConnection);
 }
 
+#if QT_CONFIG(thread)
+/*!
+    \internal
+
+    Returns the engine running the file operations, which is created the first
+    time it is needed.
+*/
+QFileOperationEngine *QFileSystemModelPrivate::fileOperationEngine()
+{
+    if (!fileOperations) {
+        Q_Q(QFileSystemModel);
+        fileOperations = std::make_unique<QFileOperationEngine>();
+        QFileOperationEngine *engine = fileOperations.get();
+        q->connect(engine, &QFileOperationEngine::progress,
+                   q, &QFileSystemModel::fileOperationProgress);
+        q->connect(engine, &QFileOperationEngine::finished,
+                   q, &QFileSystemModel::fileOperationFinished);
+        QObjectPrivate::connect(engine, &QFileOperationEngine::itemFinished,
+                                this, &QFileSystemModelPrivate::fileOperationItemFinished);
+        QObjectPrivate::connect(engine, &QFileOperationEngine::entriesRemoved,
+                                this, &QFileSystemModelPrivate::fileOperationEntriesRemoved);
+#if QT_CONFIG(filesystemwatcher) && defined(Q_OS_WIN)
+        QObjectPrivate::connect(engine, &QFileOperationEngine::finished,
+                                this, &QFileSystemModelPrivate::fileOperationFinished);
+#endif
+    }
+    return fileOperations.get();
+}
+
+/*!
+    \internal
+
+    Updates the model for an item of a file operation that is done, without
+    waiting for the watcher: \a target is looked up if its directory is
+    loaded, and \a source is removed if it was moved.
+*/
+void QFileSystemModelPrivate::fileOperationItemFinished(int operation, const QString &source,
+                                                        const QString &target, bool success)
+{
+    Q_UNUSED(operation);
+    Q_UNUSED(success); // a failed item may still have changed things
+    const QFileInfo sourceInfo(source);
+    if (!sourceInfo.exists() && !sourceInfo.isSymLink()) {
+        QFileSystemNode *parentNode = loadedNode(sourceInfo.path());
+        const QString name = sourceInfo.fileName();
+        if (parentNode && parentNode != &root && (parentNode->children.contains(name)
+                                    || (parentNode->entries && parentNode->entries->contains(name)))) {
+            removeNode(parentNode, name);
+        }
+    }
+#if QT_CONFIG(filesystemwatcher)
+    const QFileInfo targetInfo(target);
+    if (targetInfo.exists() || targetInfo.isSymLink()) {
+        const QFileSystemNode *parentNode = loadedNode(targetInfo.path());
+        if (parentNode && parentNode != &root && parentNode->populatedChildren)
+            fileInfoGatherer->fetchExtendedInformation(targetInfo.path(), { targetInfo.fileName() });
+    }
+#else
+    Q_UNUSED(target);
+#endif
+}
+
+/*!
+    \internal
+
+    Removes the rows of \a names in \a directory, which a deletion just
+    removed from the file system.
+*/
+void QFileSystemModelPrivate::fileOperationEntriesRemoved(int operation, const QString &directory,
+                                                          const QStringList &names)
+{
+    Q_UNUSED(operation);
+    QFileSystemNode *parentNode = loadedNode(directory);
+    if (!parentNode || parentNode == &root)
+        return;
+    QStringList loaded;
+    for (const QString &name : names) {
+        if (parentNode->children.contains(name)
+            || (parentNode->entries && parentNode->entries->contains(name))) {
+            loaded.append(name);
+        }
+    }
+    removeNodes(parentNode, loaded);
+}
+
+#if QT_CONFIG(filesystemwatcher) && defined(Q_OS_WIN)
+void QFileSystemModelPrivate::fileOperationFinished(int operation, bool success)
+{
+    const QStringList watchedPaths = unwatchedPaths.take(operation);
+    if (!success)
+        watchPaths(watchedPaths);
+}
+#endif
+#endif // QT_CONFIG(thread)
+
 /*!
     \internal
 
@@ -2174,47 +4830,125 @@ void QFileSystemModelPrivate::init()
 bool QFileSystemModelPrivate::filtersAcceptsNode(const QFileSystemNode *node) const
 {
     // When the model is set to only show files, then a node representing a dir
-    // should be hidden regardless of bypassFilters.
+    // should be hidden regardless of bypassesFilters().
     // QTBUG-74471
-    const bool hideDirs = (filters & (QDir::Dirs | QDir::AllDirs)) == 0;
-    const bool shouldHideDirNode = hideDirs && node->isDir();
+    const bool shouldHideDirNode = filterPredicate.hideDirs && node->isDir();
 
     // always accept drives
-    if (node->parent == &root || (!shouldHideDirNode && bypassFilters.contains(node)))
+    if (node->parent == &root || (!shouldHideDirNode && bypassesFilters(node)))
         return true;
 
-    // If we don't know anything yet don't accept it
-    if (!node->hasInformation())
+    // Nodes without information carry NoInformation, which is always rejected
+    if (node->attributes & filterPredicate.rejectMask)
+        return false;
+
+    return !filterPredicate.checkNames || passNameFilters(node);
+}
+
+/*!
+    \internal
+
+    Same as filtersAcceptsNode() for a child of the virtualized directory
+    \a parentNode, which might not have a node.
+*/
+bool QFileSystemModelPrivate::filtersAcceptsEntry(const QFileSystemNode *parentNode,
+                                                  const QFileSystemNode::Entry &entry) const
+{
+    if (const QFileSystemNode *child = parentNode->children.value(entry.fileName))
+        return filtersAcceptsNode(child);
+
+    if (entry.attributes & filterPredicate.rejectMask)
         return false;
 
+    return !filterPredicate.checkNames
+        || passNameFilters(entry.fileName, entry.attributes & QFileSystemNode::Dir);
+}
+
+/*!
+    \internal
+
+    Appends the children of \a parentNode that pass the filters to \a accepted
+    and marks the others as not visible. The attribute masks of all children
+    are tested in one pass over a contiguous array before the few nodes that
+    need a closer look (bypassed nodes, drives, name filters) are considered.
+*/
+void QFileSystemModelPrivate::filterChildren(QFileSystemNode *parentNode,
+                                             QList<QFileSystemNode *> &accepted)
+{
+    const qsizetype count = parentNode->children.size();
+    QVarLengthArray<QFileSystemNode *, 256> nodes;
+    QVarLengthArray<quint16, 256> attributes;
+    nodes.reserve(count);
+    attributes.reserve(count);
+    for (QFileSystemNode *child : std::as_const(parentNode->children)) {
+        nodes.append(child);
+        attributes.append(child->attributes);
+    }
+
+    const quint16 rejectMask = filterPredicate.rejectMask;
+    QVarLengthArray<bool, 256> passed(count);
+    for (qsizetype i = 0; i < count; ++i)
+        passed[i] = (attributes[i] & rejectMask) == 0;
+
+    const bool isDrives = (parentNode == &root);
+    accepted.reserve(accepted.size() + count);
+    for (qsizetype i = 0; i < count; ++i) {
+        QFileSystemNode *child = nodes[i];
+        bool accept = passed[i] && (!filterPredicate.checkNames || passNameFilters(child));
+        if (!accept) {
+            accept = isDrives || (!(filterPredicate.hideDirs && child->isDir())
+                                  && bypassesFilters(child));
+        }
+        if (accept)
+            accepted.append(child);
+        else
+            child->isVisible = false;
+    }
+}
+
+/*!
+    \internal
+
+    Compiles filters, nameFilters and nameFilterDisables into filterPredicate.
+    Must be called whenever one of them changes.
+*/
+void QFileSystemModelPrivate::updateFilterPredicate()
+{
+    using Node = QFileSystemNode;
     const bool filterPermissions = ((filters & QDir::PermissionMask)
                                    && (filters & QDir::PermissionMask) != QDir::PermissionMask);
-    const bool hideFiles         = !(filters & QDir::Files);
-    const bool hideReadable      = !(!filterPermissions || (filters & QDir::Readable));
-    const bool hideWritable      = !(!filterPermissions || (filters & QDir::Writable));
-    const bool hideExecutable    = !(!filterPermissions || (filters & QDir::Executable));
-    const bool hideHidden        = !(filters & QDir::Hidden);
-    const bool hideSystem        = !(filters & QDir::System);
-    const bool hideSymlinks      = (filters & QDir::NoSymLinks);
-    const bool hideDot           = (filters & QDir::NoDot);
-    const bool hideDotDot        = (filters & QDir::NoDotDot);
+    const bool hideDirs = (filters & (QDir::Dirs | QDir::AllDirs)) == 0;
 
     // Note that we match the behavior of entryList and not QFileInfo on this.
-    bool isDot    = (node->fileName == "."_L1);
-    bool isDotDot = (node->fileName == ".."_L1);
-    if (   (hideHidden && !(isDot || isDotDot) && node->isHidden())
-        || (hideSystem && node->isSystem())
-        || (hideDirs && node->isDir())
-        || (hideFiles && node->isFile())
-        || (hideSymlinks && node->isSymLink())
-        || (hideReadable && node->isReadable())
-        || (hideWritable && node->isWritable())
-        || (hideExecutable && node->isExecutable())
-        || (hideDot && isDot)
-        || (hideDotDot && isDotDot))
-        return false;
-
-    return nameFilterDisables || passNameFilters(node);
+    quint16 mask = Node::NoInformation;
+    if (hideDirs)
+        mask |= Node::Dir;
+    if (!(filters & QDir::Files))
+        mask |= Node::File;
+    if (filterPermissions && !(filters & QDir::Readable))
+        mask |= Node::Readable;
+    if (filterPermissions && !(filters & QDir::Writable))
+        mask |= Node::Writable;
+    if (filterPermissions && !(filters & QDir::Executable))
+        mask |= Node::Executable;
+    if (!(filters & QDir::Hidden))
+        mask |= Node::Hidden;
+    if (!(filters & QDir::System))
+        mask |= Node::System;
+    if (filters & QDir::NoSymLinks)
+        mask |= Node::SymLink;
+    if (filters & QDir::NoDot)
+        mask |= Node::Dot;
+    if (filters & QDir::NoDotDot)
+        mask |= Node::DotDot;
+
+    filterPredicate.rejectMask = mask;
+    filterPredicate.hideDirs = hideDirs;
+#if QT_CONFIG(regularexpression)
+    filterPredicate.checkNames = !nameFilterDisables && !nameFilters.isEmpty();
+#else
+    filterPredicate.checkNames = false;
+#endif
 }
 
 /*
@@ -2223,41 +4957,110 @@ bool QFileSystemModelPrivate::filtersAcceptsNode(const QFileSystemNode *node) co
     Returns \c true if node passes the name filters and should be visible.
  */
 bool QFileSystemModelPrivate::passNameFilters(const QFileSystemNode *node) const
+{
+    return passNameFilters(node->fileName, node->isDir());
+}
+
+bool QFileSystemModelPrivate::passNameFilters(const QString &fileName, bool isDir) const
 {
 #if QT_CONFIG(regularexpression)
     if (nameFilters.isEmpty())
         return true;
 
     // Check the name regularexpression filters
-    if (!(node->isDir() && (filters & QDir::AllDirs))) {
-        const auto matchesNodeFileName = [node](const QRegularExpression &re)
-        {
-            return node->fileName.contains(re);
-        };
-        return std::any_of(nameFiltersRegexps.begin(),
-                           nameFiltersRegexps.end(),
-                           matchesNodeFileName);
-    }
+    if (!(isDir && (filters & QDir::AllDirs)))
+        return nameFilterMatcher.matches(fileName);
 #else
-    Q_UNUSED(node);
+    Q_UNUSED(fileName);
+    Q_UNUSED(isDir);
 #endif
     return true;
 }
 
 #if QT_CONFIG(regularexpression)
-void QFileSystemModelPrivate::rebuildNameFilterRegexps()
+void QFileSystemModelPrivate::rebuildNameFilterMatcher()
 {
-    nameFiltersRegexps.clear();
-    nameFiltersRegexps.reserve(nameFilters.size());
     const auto cs = (filters & QDir::CaseSensitive) ? Qt::CaseSensitive : Qt::CaseInsensitive;
-    const auto convertWildcardToRegexp = [cs](const QString &nameFilter)
-    {
-        return QRegularExpression::fromWildcard(nameFilter, cs);
-    };
-    std::transform(nameFilters.constBegin(),
-                   nameFilters.constEnd(),
-                   std::back_inserter(nameFiltersRegexps),
-                   convertWildcardToRegexp);
+    nameFilterMatcher = QFileNameFilterMatcher(nameFilters, cs);
+}
+
+/*!
+    \class QFileNameFilterMatcher
+    \inmodule QtGui
+    \internal
+
+    Matches file names against a list of wildcard name filters, as used by
+    QFileSystemModel::setNameFilters() and QFileDialog.
+
+    Filters of the form \c{*.ext}, where \c ext contains no wildcard
+    characters, are stored in a hash of suffixes; a file name is checked
+    against them with one lookup per dot in the name. The remaining filters
+    are joined into one regular expression, so a long list of filters costs
+    a handful of hash lookups plus at most one regular expression match.
+*/
+
+static bool isPlainSuffixFilter(const QString &nameFilter)
+{
+    if (nameFilter.size() < 3 || !nameFilter.startsWith("*."_L1))
+        return false;
+    for (qsizetype i = 2; i < nameFilter.size(); ++i) {
+        switch (nameFilter.at(i).unicode()) {
+        case u'*':
+        case u'?':
+        case u'[':
+        case u']':
+        case u'\\':
+            return false;
+        default:
+            break;
+        }
+    }
+    return true;
+}
+
+QFileNameFilterMatcher::QFileNameFilterMatcher(const QStringList &nameFilters,
+                                               Qt::CaseSensitivity cs)
+    : caseSensitivity(cs)
+{
+    QStringList remaining;
+    for (const QString &nameFilter : nameFilters) {
+        if (isPlainSuffixFilter(nameFilter)) {
+            const QString suffix = nameFilter.sliced(2);
+            suffixes.insert(cs == Qt::CaseSensitive ? suffix : suffix.toCaseFolded());
+        } else {
+            // the converted expressions are anchored, so they can simply be alternated
+            remaining.append(u"(?:"_s + QRegularExpression::wildcardToRegularExpression(nameFilter)
+                             + u')');
+        }
+    }
+    if (!remaining.isEmpty()) {
+        patterns.setPattern(remaining.join(u'|'));
+        patterns.setPatternOptions(cs == Qt::CaseSensitive
+                                   ? QRegularExpression::NoPatternOption
+                                   : QRegularExpression::CaseInsensitiveOption);
+        patterns.optimize();
+        hasPatterns = true;
+    }
+}
+
+/*!
+    \internal
+
+    Returns \c true if \a fileName matches any of the name filters.
+*/
+bool QFileNameFilterMatcher::matches(const QString &fileName) const
+{
+    if (!suffixes.isEmpty() && fileName.contains(u'.')) {
+        // Fold the name once, which only copies it if folding changes it,
+        // and look its suffixes up as views of it. Folding keeps every code
+        // unit in place.
+        const QString name = caseSensitivity == Qt::CaseSensitive ? fileName : fileName.toCaseFolded();
+        for (qsizetype dot = name.indexOf(u'.'); dot != -1; dot = name.indexOf(u'.', dot + 1)) {
+            if (suffixes.contains(QStringView(name).sliced(dot + 1)))
+                return true;
+        }
+    }
+    return hasPatterns && patterns.match(fileName).hasMatch();
 }
 #endif
 
@@ -17,6 +17,40 @@ QT_BEGIN_NAMESPACE
 class ExtendedInformation;
 class QFileSystemModelPrivate;
 class QAbstractFileIconProvider;
+class QFileSystemModelTreePrivate;
+
+class Q_GUI_EXPORT QFileSystemModelTree
+{
+public:
+    QFileSystemModelTree() noexcept;
+    QFileSystemModelTree(const QFileSystemModelTree &other) noexcept;
+    QFileSystemModelTree(QFileSystemModelTree &&other) noexcept
+        : d(std::exchange(other.d, nullptr)) {}
+    QFileSystemModelTree &operator=(const QFileSystemModelTree &other) noexcept;
+    QT_MOVE_ASSIGNMENT_OPERATOR_IMPL_VIA_PURE_SWAP(QFileSystemModelTree)
+    ~QFileSystemModelTree();
+
+    void swap(QFileSystemModelTree &other) noexcept { qt_ptr_swap(d, other.d); }
+
+    bool isNull() const noexcept { return !d; }
+    quint64 version() const noexcept;
+
+    bool exists(const QString &path) const;
+    bool isDir(const QString &path) const;
+    bool isListed(const QString &path) const;
+    qint64 size(const QString &path) const;
+    QDateTime lastModified(const QString &path) const;
+    QFile::Permissions permissions(const QString &path) const;
+    QStringList entryList(const QString &path) const;
+
+private:
+    friend class QFileSystemModel;
+    explicit QFileSystemModelTree(QFileSystemModelTreePrivate *dd) noexcept : d(dd) {}
+
+    QFileSystemModelTreePrivate *d = nullptr;
+};
+
+Q_DECLARE_SHARED(QFileSystemModelTree)
 
 class Q_GUI_EXPORT QFileSystemModel : public QAbstractItemModel
 {
@@ -25,11 +59,17 @@ class Q_GUI_EXPORT QFileSystemModel : public QAbstractItemModel
     Q_PROPERTY(bool readOnly READ isReadOnly WRITE setReadOnly)
     Q_PROPERTY(bool nameFilterDisables READ nameFilterDisables WRITE setNameFilterDisables)
     Q_PROPERTY(Options options READ options WRITE setOptions)
+    Q_PROPERTY(int virtualizationThreshold READ virtualizationThreshold
+               WRITE setVirtualizationThreshold)
+    Q_PROPERTY(qint64 memoryBudget READ memoryBudget WRITE setMemoryBudget)
 
 Q_SIGNALS:
     void rootPathChanged(const QString &newPath);
     void fileRenamed(const QString &path, const QString &oldName, const QString &newName);
     void directoryLoaded(const QString &path);
+    void fileOperationStarted(int operation);
+    void fileOperationProgress(int operation, qint64 bytesDone, qint64 bytesTotal);
+    void fileOperationFinished(int operation, bool success);
 
 public:
     enum Roles {
@@ -53,7 +93,10 @@ public:
     {
         DontWatchForChanges         = 0x00000001,
         DontResolveSymlinks         = 0x00000002,
-        DontUseCustomDirectoryIcons = 0x00000004
+        DontUseCustomDirectoryIcons = 0x00000004,
+        ComputeDirectorySizes       = 0x00000008,
+        CaseInsensitiveNames        = 0x00000010,
+        AsynchronousFileOperations  = 0x00000020
     };
     Q_ENUM(Option)
     Q_DECLARE_FLAGS(Options, Option)
@@ -63,6 +106,7 @@ public:
 
     QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
     QModelIndex index(const QString &path, int column = 0) const;
+    QModelIndexList indexes(const QStringList &paths, int column = 0) const;
     QModelIndex parent(const QModelIndex &child) const override;
     using QObject::parent;
     QModelIndex sibling(int row, int column, const QModelIndex &idx) const override;
@@ -75,6 +119,7 @@ public:
 
     QVariant myComputer(int role = Qt::DisplayRole) const;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    void multiData(const QModelIndex &index, QModelRoleDataSpan roleDataSpan) const override;
     bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
 
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
@@ -113,6 +158,21 @@ public:
     void setNameFilters(const QStringList &filters);
     QStringList nameFilters() const;
 
+    void setVirtualizationThreshold(int entries);
+    int virtualizationThreshold() const;
+
+    void setMemoryBudget(qint64 bytes);
+    qint64 memoryBudget() const;
+    qint64 nodeCount() const;
+    qint64 memoryUsage() const;
+
+    QModelIndexList search(const QString &text, int limit = -1) const;
+
+    bool saveSnapshot(const QString &fileName) const;
+    bool loadSnapshot(const QString &fileName);
+
+    QFileSystemModelTree publishedTree() const;
+
     void setOption(Option option, bool on = true);
     bool testOption(Option option) const;
     void setOptions(Options options);
@@ -121,6 +181,7 @@ public:
     QString filePath(const QModelIndex &index) const;
     bool isDir(const QModelIndex &index) const;
     qint64 size(const QModelIndex &index) const;
+    qint64 itemCount(const QModelIndex &index) const;
     QString type(const QModelIndex &index) const;
 
     QDateTime lastModified(const QModelIndex &index) const;
@@ -133,6 +194,7 @@ public:
     QFile::Permissions permissions(const QModelIndex &index) const;
     QFileInfo fileInfo(const QModelIndex &index) const;
     bool remove(const QModelIndex &index);
+    void cancelFileOperation(int operation);
 
 protected:
     QFileSystemModel(QFileSystemModelPrivate &, QObject *parent = nullptr);
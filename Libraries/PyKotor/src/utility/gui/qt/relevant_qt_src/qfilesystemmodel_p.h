@@ -25,9 +25,20 @@
 #include <qdir.h>
 #include <qicon.h>
 #include <qfileinfo.h>
+#include <qlocale.h>
+#include <qmimedata.h>
 #include <qtimer.h>
 #include <qhash.h>
+#include <qcache.h>
+#include <qset.h>
+#if QT_CONFIG(regularexpression)
+#  include <qregularexpression.h>
+#endif
+#if QT_CONFIG(thread)
+#  include "qfileoperationengine_p.h"
+#endif
 
+#include <memory>
 #include <vector>
 
 QT_REQUIRE_CONFIG(filesystemmodel);
@@ -36,27 +47,143 @@ QT_BEGIN_NAMESPACE
 
 class ExtendedInformation;
 class QFileSystemModelPrivate;
+class QFileSystemModelMimeData;
 class QFileIconProvider;
 
-#if defined(Q_OS_WIN)
+// The name of a child, as the key of QFileSystemNode::children. Keys made
+// case insensitive, as are all keys on Windows, compare equal to any key
+// whose name only differs in case; elsewhere they are only made for lookups,
+// see QFileSystemModelPrivate::lookupChild(). The hash is the one of the case
+// folded name in any case, so that such lookups work. It is seeded like any
+// other hash, and computed once with the global seed, which QHash uses, when
+// the key is made, without building the folded string.
 class QFileSystemModelNodePathKey : public QString
 {
 public:
+#if defined(Q_OS_WIN)
+    static constexpr bool DefaultCaseInsensitive = true;
+#else
+    static constexpr bool DefaultCaseInsensitive = false;
+#endif
+
     QFileSystemModelNodePathKey() {}
-    QFileSystemModelNodePathKey(const QString &other) : QString(other) {}
-    QFileSystemModelNodePathKey(const QFileSystemModelNodePathKey &other) : QString(other) {}
-    bool operator==(const QFileSystemModelNodePathKey &other) const { return !compare(other, Qt::CaseInsensitive); }
+    QFileSystemModelNodePathKey(const QString &other, bool caseInsensitive = DefaultCaseInsensitive)
+        : QString(other), foldedHash(hashFolded(other, QHashSeed::globalSeed())),
+          caseInsensitive(caseInsensitive) {}
+    QFileSystemModelNodePathKey(const QFileSystemModelNodePathKey &other) = default;
+    QFileSystemModelNodePathKey(QFileSystemModelNodePathKey &&other) noexcept = default;
+    QFileSystemModelNodePathKey &operator=(const QFileSystemModelNodePathKey &other) = default;
+    QFileSystemModelNodePathKey &operator=(QFileSystemModelNodePathKey &&other) noexcept = default;
+    bool operator==(const QFileSystemModelNodePathKey &other) const
+    {
+        // case folding maps each UTF-16 code unit to one code unit
+        if (foldedHash != other.foldedHash || size() != other.size())
+            return false;
+        if (caseInsensitive || other.caseInsensitive)
+            return !compare(other, Qt::CaseInsensitive);
+        return static_cast<const QString &>(*this) == static_cast<const QString &>(other);
+    }
+
+    size_t hash(size_t seed) const noexcept
+    {
+        return seed == QHashSeed::globalSeed() ? foldedHash : hashFolded(*this, seed);
+    }
+
+    // Hashes the case folded name in chunks, each one mixed into the hash of
+    // the previous ones, starting from seed
+    static size_t hashFolded(QStringView name, size_t seed) noexcept
+    {
+        constexpr qsizetype ChunkSize = 64;
+        char32_t chunk[ChunkSize];
+        qsizetype n = 0;
+        size_t h = seed;
+        for (qsizetype i = 0; i < name.size(); ++i) {
+            char32_t c = name.at(i).unicode();
+            if (c < 0x80) {
+                if (c >= u'A' && c <= u'Z')
+                    c += u'a' - u'A';
+            } else {
+                if (QChar::isHighSurrogate(c) && i + 1 < name.size()
+                    && name.at(i + 1).isLowSurrogate()) {
+                    c = QChar::surrogateToUcs4(char16_t(c), name.at(++i).unicode());
+                }
+                c = QChar::toCaseFolded(c);
+            }
+            chunk[n++] = c;
+            if (n == ChunkSize) {
+                h = qHashBits(chunk, sizeof(chunk), h);
+                n = 0;
+            }
+        }
+        return qHashBits(chunk, n * sizeof(char32_t), h);
+    }
+
+private:
+    size_t foldedHash = 0;
+    bool caseInsensitive = DefaultCaseInsensitive;
 };
 
 Q_DECLARE_TYPEINFO(QFileSystemModelNodePathKey, Q_RELOCATABLE_TYPE);
 
-inline size_t qHash(const QFileSystemModelNodePathKey &key, size_t seed = 0)
+inline size_t qHash(const QFileSystemModelNodePathKey &key, size_t seed = 0) noexcept
 {
-    return qHash(key.toCaseFolded(), seed);
+    return key.hash(seed);
 }
-#else // Q_OS_WIN
-typedef QString QFileSystemModelNodePathKey;
-#endif
+
+#if QT_CONFIG(regularexpression)
+// Matches file names against a list of wildcard name filters. Plain "*.ext"
+// patterns become a hash lookup of the (case-folded) suffix; all other
+// patterns are combined into a single regular expression.
+class Q_GUI_EXPORT QFileNameFilterMatcher
+{
+public:
+    QFileNameFilterMatcher() = default;
+    explicit QFileNameFilterMatcher(const QStringList &nameFilters,
+                                    Qt::CaseSensitivity cs = Qt::CaseInsensitive);
+
+    bool isEmpty() const { return suffixes.isEmpty() && !hasPatterns; }
+    bool matches(const QString &fileName) const;
+
+private:
+    QSet<QString> suffixes;
+    QRegularExpression patterns;
+    Qt::CaseSensitivity caseSensitivity = Qt::CaseInsensitive;
+    bool hasPatterns = false;
+};
+#endif // QT_CONFIG(regularexpression)
+
+// The children of a directory at the time a QFileSystemModelTree was
+// published. Never modified once published, so that other threads can read
+// it; the node keeps it for the next tree until its children change.
+class QFileSystemModelTreeDirectory : public QSharedData
+{
+public:
+    struct File {
+        QString fileName;
+        qint64 size = 0;
+        qint64 lastModified = 0; // msecs since epoch
+        QFile::Permissions permissions;
+        bool isDir = false;
+        // only set for the directories whose children are loaded
+        QExplicitlySharedDataPointer<QFileSystemModelTreeDirectory> directory;
+    };
+    QHash<QFileSystemModelNodePathKey, File> files;
+    bool listed = false;
+};
+
+class QFileSystemModelTreePrivate
+{
+public:
+    QFileSystemModelTreePrivate(QExplicitlySharedDataPointer<QFileSystemModelTreeDirectory> root,
+                                quint64 version)
+        : root(std::move(root)), version(version)
+    {
+    }
+
+    QAtomicInt ref = 1;
+    QExplicitlySharedDataPointer<QFileSystemModelTreeDirectory> root;
+    quint64 version = 0;
+};
 
 class Q_GUI_EXPORT QFileSystemModelPrivate : public QAbstractItemModelPrivate
 {
@@ -89,6 +216,8 @@ public:
 #endif
 
         inline qint64 size() const { if (info && !info->isDir()) return info->size(); return 0; }
+        // the recursive size for directories, once it is known
+        inline qint64 sortSize() const { return totalSize >= 0 && isDir() ? totalSize : size(); }
         inline QString type() const { if (info) return info->displayType; return QLatin1StringView(""); }
         inline QDateTime lastModified(const QTimeZone &tz) const { return info ? info->lastModified(tz) : QDateTime(); }
         inline QFile::Permissions permissions() const { if (info) return info->permissions(); return { }; }
@@ -98,6 +227,8 @@ public:
         inline bool isDir() const {
             if (info)
                 return info->isDir();
+            if (hasAttributes())
+                return attributes & Dir;
             if (children.size() > 0)
                 return true;
             return false;
@@ -138,61 +269,187 @@ public:
         }
 
         inline bool hasInformation() const { return info != nullptr; }
+        // The filter attributes are known, from the information or from an entry
+        inline bool hasAttributes() const { return !(attributes & NoInformation); }
 
         void populate(const QExtendedInformation &fileInfo) {
             if (!info)
                 info = new QExtendedInformation(fileInfo.fileInfo());
             (*info) = fileInfo;
+            updateAttributes();
+            if (displayStrings)
+                *displayStrings = { displayStrings->localeGeneration };
         }
 
-        // children shouldn't normally be accessed directly, use node()
-        inline int visibleLocation(const QString &childName) {
-            return visibleChildren.indexOf(childName);
+        // Summary of the information the filters look at, see FilterPredicate
+        enum Attribute : quint16 {
+            Hidden = 0x0001, // hidden, and neither "." nor ".."
+            System = 0x0002,
+            Dir = 0x0004,
+            File = 0x0008,
+            SymLink = 0x0010,
+            Readable = 0x0020,
+            Writable = 0x0040,
+            Executable = 0x0080,
+            Dot = 0x0100,
+            DotDot = 0x0200,
+            NoInformation = 0x8000
+        };
+
+        void updateAttributes() { attributes = attributesOf(fileName, info->fileInfo()); }
+
+        static quint16 attributesOf(const QString &fileName, const QFileInfo &fileInfo) {
+            quint16 a = 0;
+            const bool isDot = (fileName == QLatin1StringView("."));
+            const bool isDotDot = (fileName == QLatin1StringView(".."));
+            if (isDot)
+                a |= Dot;
+            if (isDotDot)
+                a |= DotDot;
+            if (!(isDot || isDotDot) && fileInfo.isHidden())
+                a |= Hidden;
+            // same classification as QExtendedInformation::type()
+            if (fileInfo.isDir())
+                a |= Dir;
+            else if (fileInfo.isFile())
+                a |= File;
+            else
+                a |= System;
+            if (fileInfo.isSymLink())
+                a |= SymLink;
+            const QFile::Permissions p = fileInfo.permissions();
+            if (p & QFile::ReadUser)
+                a |= Readable;
+            if (p & QFile::WriteUser)
+                a |= Writable;
+            if (p & QFile::ExeUser)
+                a |= Executable;
+            return a;
         }
-        void updateIcon(QAbstractFileIconProvider *iconProvider, const QString &path) {
-            if (!iconProvider)
-                return;
 
-            if (info)
-                info->icon = iconProvider->icon(QFileInfo(path));
-
-            for (QFileSystemNode *child : std::as_const(children)) {
-                //On windows the root (My computer) has no path so we don't want to add a / for nothing (e.g. /C:/)
-                if (!path.isEmpty()) {
-                    if (path.endsWith(u'/'))
-                        child->updateIcon(iconProvider, path + child->fileName);
-                    else
-                        child->updateIcon(iconProvider, path + u'/' + child->fileName);
-                } else
-                    child->updateIcon(iconProvider, child->fileName);
+        // Compact stand-in for a child of a virtualized directory that does
+        // not have a node of its own, see QFileSystemModel::virtualizationThreshold
+        struct Entry {
+            QString fileName;
+            qint64 size = 0;
+            qint64 lastModified = 0; // msecs since epoch
+            quint16 attributes = NoInformation;
+            bool isVisible = false;
+
+            bool sameMetaData(const Entry &other) const {
+                return size == other.size && lastModified == other.lastModified
+                    && attributes == other.attributes;
             }
+        };
+
+        static Entry entryFor(const QString &fileName, const QFileInfo &fileInfo) {
+            Entry entry;
+            entry.fileName = fileName;
+            entry.attributes = attributesOf(fileName, fileInfo);
+            if (entry.attributes & File)
+                entry.size = fileInfo.size();
+            if (!fileInfo.exists() && !fileInfo.isSymLink())
+                entry.size = -1;
+            entry.lastModified = fileInfo.lastModified(QTimeZone::UTC).toMSecsSinceEpoch();
+            return entry;
         }
 
-        void retranslateStrings(QAbstractFileIconProvider *iconProvider, const QString &path) {
-            if (!iconProvider)
-                return;
-
-            if (info)
-                info->displayType = iconProvider->type(QFileInfo(path));
-            for (QFileSystemNode *child : std::as_const(children)) {
-                //On windows the root (My computer) has no path so we don't want to add a / for nothing (e.g. /C:/)
-                if (!path.isEmpty()) {
-                    if (path.endsWith(u'/'))
-                        child->retranslateStrings(iconProvider, path + child->fileName);
-                    else
-                        child->retranslateStrings(iconProvider, path + u'/' + child->fileName);
-                } else
-                    child->retranslateStrings(iconProvider, child->fileName);
-            }
+        Entry toEntry() const {
+            Entry entry;
+            entry.fileName = fileName;
+            entry.attributes = attributes;
+            entry.size = sortSize();
+            entry.lastModified = lastModified(QTimeZone::UTC).toMSecsSinceEpoch();
+            entry.isVisible = isVisible;
+            return entry;
         }
 
+        // children shouldn't normally be accessed directly, use node()
+        inline int visibleLocation(const QString &childName) const {
+            const QFileSystemNode *child = children.value(childName);
+            if (child && child->fileName == childName)
+                return visibleLocation(child);
+            return visibleChildren.indexOf(childName);
+        }
+        int visibleLocation(const QFileSystemNode *child) const;
+        void updateVisibleRows(int from) const;
         QHash<QFileSystemModelNodePathKey, QFileSystemNode *> children;
         QList<QString> visibleChildren;
         QExtendedInformation *info = nullptr;
         QFileSystemNode *parent;
         int dirtyChildrenIndex = -1;
+        // Row of this node in the visible children of its parent when it was
+        // last looked up or moved, only a hint, see visibleLocation()
+        mutable int visibleRow = -1;
+        // Value of QFileSystemModelPrivate::useCounter when the node or its
+        // children were last asked for
+        quint32 lastUsed = 0;
+        // Generation in which the node was made to bypass the filters, 0 if never
+        quint32 bypassGeneration = 0;
+        // Value of QFileSystemModelPrivate::decorationGeneration when the icon
+        // and the type were last resolved
+        quint32 decorationGeneration = 0;
+        // Recursive size and number of items of a directory, -1 if unknown,
+        // see QFileSystemModel::ComputeDirectorySizes
+        qint64 totalSize = -1;
+        qint64 totalItems = -1;
+        quint16 attributes = NoInformation;
         bool populatedChildren = false;
         bool isVisible = false;
+        // The first listing of the children has been received
+        bool listed = false;
+        // The recursive size of this directory is being computed
+        bool sizePending = false;
+        // The directory is new, add its recursive size to its parents' once known
+        bool addSizeToParents = false;
+        // Only set for virtualized directories: they keep an entry for every
+        // child, while children only holds the nodes that have been asked for.
+        std::unique_ptr<QHash<QFileSystemModelNodePathKey, Entry>> entries;
+        // The children as last published, reset whenever they change
+        QExplicitlySharedDataPointer<QFileSystemModelTreeDirectory> published;
+
+        // Formatted size and time, only built for the rows a view asks for and
+        // cleared when the information changes, see QFileSystemModelPrivate::displayStrings()
+        struct DisplayStrings {
+            quint32 localeGeneration = 0;
+            qint64 bytes = -1; // the size that was formatted
+            QString size;
+            QString time;
+        };
+        std::unique_ptr<DisplayStrings> displayStrings;
+    };
+
+    // Trigram index over the names of the loaded children of every directory,
+    // built on the first QFileSystemModel::search() and kept up to date after
+    class SearchIndex
+    {
+    public:
+        struct Item {
+            const QFileSystemNode *parent = nullptr; // nullptr once removed
+            QString fileName;
+        };
+
+        void insert(const QFileSystemNode *parent, const QString &fileName);
+        void remove(const QFileSystemNode *parent, const QString &fileName);
+        void removeChildren(const QFileSystemNode *parent);
+        QList<Item> find(const QString &text) const;
+        qsizetype size() const { return items.size() - removedCount; }
+
+    private:
+        static quint64 trigram(const QString &folded, qsizetype i)
+        {
+            return (quint64(folded.at(i).unicode()) << 32)
+                 | (quint64(folded.at(i + 1).unicode()) << 16)
+                 | quint64(folded.at(i + 2).unicode());
+        }
+        void addPostings(quint32 id);
+        void compact();
+
+        QList<Item> items;
+        qsizetype removedCount = 0;
+        // trigram of the case folded name -> ids of the items containing it, ascending
+        QHash<quint64, QList<quint32>> postings;
+        QHash<const QFileSystemNode *, QHash<QFileSystemModelNodePathKey, quint32>> itemsByParent;
     };
 
     QFileSystemModelPrivate();
@@ -209,15 +466,127 @@ public:
     }
     QFileSystemNode *node(const QModelIndex &index) const;
     QFileSystemNode *node(const QString &path, bool fetch = true) const;
+    QList<QFileSystemNode *> nodes(const QStringList &paths, bool fetch = true) const;
+    QFileSystemNode *resolveChild(QFileSystemNode *parent, QString element, QString &elementPath,
+                                  bool fetch) const;
+    QFileSystemNode *cachedNode(const QString &path) const;
+    QFileSystemNode *loadedNode(const QString &path) const;
+    void cacheNode(const QString &path, QFileSystemNode *node) const;
+    inline void invalidatePathCaches() { nodeCache.clear(); filePathPrefixNode = nullptr; filePathPrefix.clear(); }
     inline QModelIndex index(const QString &path, int column = 0) { return index(node(path), column); }
     QModelIndex index(const QFileSystemNode *node, int column = 0) const;
     bool filtersAcceptsNode(const QFileSystemNode *node) const;
+    bool filtersAcceptsEntry(const QFileSystemNode *parentNode, const QFileSystemNode::Entry &entry) const;
+    void filterChildren(QFileSystemNode *parentNode, QList<QFileSystemNode *> &accepted);
     bool passNameFilters(const QFileSystemNode *node) const;
+    bool passNameFilters(const QString &fileName, bool isDir) const;
+    void updateFilterPredicate();
     void removeNode(QFileSystemNode *parentNode, const QString &name);
+    void removeNodes(QFileSystemNode *parentNode, const QStringList &names);
+    void removeVisibleChildren(QFileSystemNode *parentNode, const QList<int> &vLocations);
     QFileSystemNode* addNode(QFileSystemNode *parentNode, const QString &fileName, const QFileInfo &info);
+    QFileSystemNode *addNode(QFileSystemNode *parentNode, const QFileSystemNode::Entry &entry);
+    QFileSystemNode *insertNode(QFileSystemNode *parentNode, QFileSystemNode *node);
     void addVisibleFiles(QFileSystemNode *parentNode, const QStringList &newFiles);
-    void removeVisibleFile(QFileSystemNode *parentNode, int visibleLocation);
+    void removeVisibleFiles(QFileSystemNode *parentNode, const QStringList &names);
+    void setChildVisible(QFileSystemNode *parentNode, const QString &name, bool visible);
     void sortChildren(int column, const QModelIndex &parent);
+    void sortEntries(int column, QFileSystemNode *parentNode);
+
+    QFileSystemNode *childNode(QFileSystemNode *parentNode, const QString &name) const;
+    void virtualize(QFileSystemNode *parentNode);
+    void syncEntry(QFileSystemNode *parentNode, const QFileSystemNode *node);
+    void forgetNodes(const QFileSystemNode *node);
+    void buildSearchIndex();
+
+    // The key of the child \a name in the children and entries of a node.
+    // The file system decides which names are the same, never the model, so
+    // that it keeps all the files the file system has.
+    static QFileSystemModelNodePathKey nameKey(const QString &name)
+    {
+        return QFileSystemModelNodePathKey(name);
+    }
+    // The child \a name of \a parentNode: the one of that exact name, or else,
+    // with CaseInsensitiveNames, one whose name only differs in case
+    QFileSystemNode *lookupChild(const QFileSystemNode *parentNode, const QString &name) const
+    {
+        QFileSystemNode *child = parentNode->children.value(name);
+        if (!child && caseInsensitiveNames && !QFileSystemModelNodePathKey::DefaultCaseInsensitive)
+            child = parentNode->children.value(QFileSystemModelNodePathKey(name, true));
+        return child;
+    }
+    void setCaseInsensitiveNames(bool enable);
+
+    // Layout of the files written by QFileSystemModel::saveSnapshot(): the
+    // header, the records and then the UTF-16 names of the records. Record 0
+    // is root, and the children of a record are consecutive, sorted by name.
+    struct SnapshotHeader {
+        char magic[8];
+        quint32 version;
+        quint32 byteOrder;
+        quint32 recordCount;
+        quint32 nameLength; // in UTF-16 code units
+    };
+    struct SnapshotRecord {
+        qint64 size;
+        qint64 lastModified; // msecs since epoch
+        quint32 nameOffset;
+        quint32 nameLength;
+        quint32 firstChild;
+        quint32 childCount;
+        quint16 attributes;
+        quint16 flags;
+        quint32 reserved;
+    };
+    enum SnapshotFlag : quint16 {
+        SnapshotPopulated = 0x0001 // the children of the record are complete
+    };
+    enum { SnapshotVersion = 1, SnapshotByteOrder = 0x01020304 };
+    const SnapshotRecord *snapshotRecord(quint32 i) const;
+    QStringView snapshotName(const SnapshotRecord *record) const;
+    const SnapshotRecord *findSnapshotRecord(const QFileSystemNode *node) const;
+    bool populateFromSnapshot(QFileSystemNode *node);
+
+    QExplicitlySharedDataPointer<QFileSystemModelTreeDirectory> publish(QFileSystemNode *node) const;
+    void invalidatePublished(QFileSystemNode *node)
+    {
+        for (; node; node = node->parent)
+            node->published.reset();
+    }
+    void trimVirtualDirectories();
+
+    static qint64 nodeFootprint(const QFileSystemNode *node);
+    static qint64 entryFootprint(const QFileSystemNode::Entry &entry);
+    QHash<QFileSystemModelNodePathKey, QFileSystemNode::Entry>::iterator
+    insertEntry(QFileSystemNode *parentNode, QFileSystemNode::Entry entry);
+    void removeEntry(QFileSystemNode *parentNode, const QString &name);
+    void releaseEntries(QFileSystemNode *node);
+    void releaseNodes(const QFileSystemNode *node);
+    void detachMimeData(const QFileSystemNode *subtree = nullptr);
+    void touch(QFileSystemNode *node) const { node->lastUsed = ++useCounter; }
+    void scheduleEviction();
+    void evictNodes();
+    void evictChildren(QFileSystemNode *node);
+
+    void adjustDirectorySizes(QFileSystemNode *parentNode, qint64 sizeDelta, qint64 itemDelta);
+    std::pair<qint64, qint64> directorySizeShare(const QFileSystemNode *parentNode,
+                                                 const QString &name) const;
+#if QT_CONFIG(filesystemwatcher)
+    void setComputeDirectorySizes(bool enable);
+    void requestDirectorySize(QFileSystemNode *node);
+    void directorySizesComputed(const QString &directory, const QList<QDirectorySize> &sizes);
+    void directoryListed(const QString &path);
+#endif
+#if QT_CONFIG(thread)
+    QFileOperationEngine *fileOperationEngine();
+    void fileOperationItemFinished(int operation, const QString &source, const QString &target,
+                                   bool success);
+    void fileOperationEntriesRemoved(int operation, const QString &directory,
+                                     const QStringList &names);
+#  if QT_CONFIG(filesystemwatcher) && defined(Q_OS_WIN)
+    void fileOperationFinished(int operation, bool success);
+#  endif
+#endif
 
     inline int translateVisibleLocation(QFileSystemNode *parent, int row) const {
         if (sortOrder != Qt::AscendingOrder) {
@@ -248,14 +617,32 @@ public:
             delayedSortTimer.start(0);
     }
 
+    QVariant data(const QModelIndex &index, int role, QString &path) const;
     QIcon icon(const QModelIndex &index) const;
-    QString name(const QModelIndex &index) const;
-    QString displayName(const QModelIndex &index) const;
+    QString name(const QModelIndex &index, QString &path) const;
+    QString displayName(const QModelIndex &index, QString &path) const;
     QString filePath(const QModelIndex &index) const;
+    // The path of index, built the first time it is asked for, see data()
+    const QString &filePath(const QModelIndex &index, QString &path) const {
+        if (path.isNull())
+            path = filePath(index);
+        return path;
+    }
+    QString resolvedFilePath(const QFileSystemNode *node, QString &path) const;
+    QString filePath(const QFileSystemNode *node) const;
+    QString buildFilePath(const QFileSystemNode *node) const;
     QString size(const QModelIndex &index) const;
     static QString size(qint64 bytes);
     QString type(const QModelIndex &index) const;
     QString time(const QModelIndex &index) const;
+    // Bumped when the language changes, or when a lookup finds that the
+    // system locale is not the display locale anymore: models are not sent
+    // QEvent::LocaleChange
+    mutable quint32 localeGeneration = 0;
+    mutable QLocale::Language displayLanguage = QLocale::AnyLanguage;
+    mutable QLocale::Script displayScript = QLocale::AnyScript;
+    mutable QLocale::Territory displayTerritory = QLocale::AnyTerritory;
+    QFileSystemNode::DisplayStrings &displayStrings(QFileSystemNode *node) const;
 
     void directoryChanged(const QString &directory, const QStringList &list);
     void performDelayedSort();
@@ -271,16 +658,55 @@ public:
     std::unique_ptr<QFileInfoGatherer> fileInfoGatherer;
 #endif // filesystemwatcher
     QTimer delayedSortTimer;
-    QHash<const QFileSystemNode*, bool> bypassFilters;
+    // A node bypasses the filters if it was marked by setBypassFilters() since
+    // the last clearBypassFilters(), which has nothing to do if none was
+    quint32 bypassGeneration = 1;
+    mutable bool hasBypassedNodes = false;
+    bool bypassesFilters(const QFileSystemNode *node) const {
+        return node->bypassGeneration == bypassGeneration;
+    }
+    void setBypassFilters(QFileSystemNode *node) const
+    {
+        node->bypassGeneration = bypassGeneration;
+        hasBypassedNodes = true;
+    }
+    void clearBypassFilters();
+#if QT_CONFIG(filesystemwatcher)
+    // Bumped when the icon provider or the language changes, the icon and the
+    // type of a node are only resolved again when they are asked for
+    quint32 decorationGeneration = 0;
+    void invalidateDecorations() { ++decorationGeneration; }
+    QFileSystemNode *decorated(QFileSystemNode *node) const {
+        if (node->decorationGeneration != decorationGeneration) {
+            node->decorationGeneration = decorationGeneration;
+            if (node->info)
+                fileInfoGatherer->resolveDecoration(*node->info);
+        }
+        return node;
+    }
+#else
+    QFileSystemNode *decorated(QFileSystemNode *node) const { return node; }
+#endif
 #if QT_CONFIG(regularexpression)
     QStringList nameFilters;
-    std::vector<QRegularExpression> nameFiltersRegexps;
-    void rebuildNameFilterRegexps();
+    QFileNameFilterMatcher nameFilterMatcher;
+    void rebuildNameFilterMatcher();
 #endif
     QHash<QString, QString> resolvedSymLinks;
 
     QFileSystemNode root;
 
+    // Bounded LRU of absolute path -> node, consulted by node(const QString &).
+    // Entries are dropped wholesale whenever a node is deleted or renamed.
+    struct NodeCacheEntry {
+        QFileSystemNode *node;
+    };
+    enum { NodeCacheSize = 1024 };
+    mutable QCache<QString, NodeCacheEntry> nodeCache;
+    // Path of the directory whose children were last passed to filePath()
+    mutable const QFileSystemNode *filePathPrefixNode = nullptr;
+    mutable QString filePathPrefix;
+
     struct Fetching {
         QString dir;
         QString file;
@@ -290,7 +716,63 @@ public:
 
     QBasicTimer fetchingTimer;
 
+    // Directories with more children than this are virtualized, 0 disables it
+    int virtualizationThreshold = 0;
+    // Virtualized directories holding more nodes than this are trimmed
+    // Trimming changes the layout of the directory, so it only happens once
+    // every TrimInterval ms while the views keep creating nodes
+    enum { VirtualNodeLimit = 512, TrimInterval = 2000 };
+    QSet<QFileSystemNode *> trimCandidates;
+    QBasicTimer trimTimer;
+
+    // Number and estimated size of the nodes below root, see memoryBudget()
+    qint64 nodeCount = 0;
+    qint64 nodeBytes = 0;
+    // 0 means unlimited
+    qint64 memoryBudget = 0;
+    // Don't look for nodes to evict again before nodeBytes reaches this
+    qint64 evictionRetryBytes = 0;
+    mutable quint32 useCounter = 0;
+    QBasicTimer evictionTimer;
+
+    std::unique_ptr<SearchIndex> searchIndex;
+
+    // The objects returned by mimeData() that still refer to nodes
+    QList<QFileSystemModelMimeData *> lazyMimeData;
+
+    // The snapshot loaded by QFileSystemModel::loadSnapshot(), mapped in memory
+    std::unique_ptr<QFile> snapshotFile;
+    const uchar *snapshotData = nullptr;
+    // Incremented whenever publishedTree() publishes a new tree
+    mutable quint64 publishedVersion = 0;
+
+    // Lookups of children by name, see QFileSystemModel::CaseInsensitiveNames
+    bool caseInsensitiveNames = QFileSystemModelNodePathKey::DefaultCaseInsensitive;
+
+    bool computeDirectorySizes = false;
+
+    // See QFileSystemModel::AsynchronousFileOperations
+    bool asynchronousFileOperations = false;
+    // remove() deletes in the background even without that option, for QFileDialog
+    bool asynchronousRemove = false;
+#if QT_CONFIG(thread)
+    std::unique_ptr<QFileOperationEngine> fileOperations;
+#  if QT_CONFIG(filesystemwatcher) && defined(Q_OS_WIN)
+    // Paths unwatched by remove() until its operation finished
+    QHash<int, QStringList> unwatchedPaths;
+#  endif
+#endif
+    // Sizes reported for directories that had no node yet, by absolute path
+    enum { DirectorySizeCacheSize = 4096 };
+    QCache<QString, QDirectorySize> directorySizeCache;
+
     QDir::Filters filters = QDir::AllEntries | QDir::NoDotAndDotDot | QDir::AllDirs;
+    // filters, nameFilters and nameFilterDisables compiled by updateFilterPredicate()
+    struct FilterPredicate {
+        quint16 rejectMask = QFileSystemNode::NoInformation;
+        bool hideDirs = false;
+        bool checkNames = false;
+    } filterPredicate;
     int sortColumn = 0;
     Qt::SortOrder sortOrder = Qt::AscendingOrder;
     bool forceSort = true;
@@ -301,7 +783,35 @@ public:
     // not recursive, meaning we sort only what we see.
     bool disableRecursiveSort = false;
 };
+// Returned by QFileSystemModel::mimeData(). Keeps the nodes of the dragged
+// items, and only builds their URLs when the drop target asks for them.
+class QFileSystemModelMimeData : public QMimeData
+{
+public:
+    using QFileSystemNode = QFileSystemModelPrivate::QFileSystemNode;
+
+    QFileSystemModelMimeData(QFileSystemModelPrivate *model, QList<const QFileSystemNode *> nodes);
+    ~QFileSystemModelMimeData() override;
+
+    bool hasFormat(const QString &mimeType) const override;
+    QStringList formats() const override;
+
+protected:
+    QVariant retrieveData(const QString &mimeType, QMetaType type) const override;
+
+private:
+    friend class QFileSystemModelPrivate;
+    void detach();
+    QStringList filePaths() const;
+
+    QFileSystemModelPrivate *model; // nullptr once detached
+    QList<const QFileSystemNode *> nodes;
+    QStringList paths; // set by detach()
+    mutable QByteArray uriList;
+};
+
 Q_DECLARE_TYPEINFO(QFileSystemModelPrivate::Fetching, Q_RELOCATABLE_TYPE);
+Q_DECLARE_TYPEINFO(QFileSystemModelPrivate::SnapshotRecord, Q_PRIMITIVE_TYPE);
 
 QT_END_NAMESPACE
 
@@ -233,13 +233,28 @@ void QUrlModel::addUrls(const QList<QUrl> &list, int row, bool move)
     if (row == -1)
         row = rowCount();
     row = qMin(row, rowCount());
-    const auto rend = list.crend();
-    for (auto it = list.crbegin(); it != rend; ++it) {
-        QUrl url = *it;
+    // Resolve the paths of the urls that can be added at once, each of them
+    // only once; the file system model is not changed below
+    QStringList cleanUrls(list.size());
+    QStringList paths;
+    QHash<QString, qsizetype> pathIndexes;
+    for (qsizetype i = 0; i < list.size(); ++i) {
+        const QUrl &url = list.at(i);
         if (!url.isValid() || url.scheme() != "file"_L1)
             continue;
         //this makes sure the url is clean
-        const QString cleanUrl = QDir::cleanPath(url.toLocalFile());
+        cleanUrls[i] = QDir::cleanPath(url.toLocalFile());
+        if (!cleanUrls.at(i).isEmpty() && !pathIndexes.contains(cleanUrls.at(i))) {
+            pathIndexes.insert(cleanUrls.at(i), paths.size());
+            paths.append(cleanUrls.at(i));
+        }
+    }
+    const QModelIndexList indexes = fileSystemModel->indexes(paths);
+    for (qsizetype i = list.size() - 1; i >= 0; --i) {
+        QUrl url = list.at(i);
+        if (!url.isValid() || url.scheme() != "file"_L1)
+            continue;
+        const QString &cleanUrl = cleanUrls.at(i);
         if (!cleanUrl.isEmpty())
             url = QUrl::fromLocalFile(cleanUrl);
 
@@ -258,7 +273,8 @@ void QUrlModel::addUrls(const QList<QUrl> &list, int row, bool move)
             }
         }
         row = qMax(row, 0);
-        QModelIndex idx = fileSystemModel->index(cleanUrl);
+        const QModelIndex idx = cleanUrl.isEmpty()
+                ? QModelIndex() : indexes.at(pathIndexes.value(cleanUrl));
         if (!fileSystemModel->isDir(idx))
             continue;
         insertRows(row, 1);
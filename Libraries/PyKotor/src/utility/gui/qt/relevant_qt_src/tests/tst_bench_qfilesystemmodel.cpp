@@ -0,0 +1,302 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#include <QTest>
+#include <QFileSystemModel>
+#include <QTemporaryDir>
+#include <QTreeView>
+#include <QHeaderView>
+#include <QScrollBar>
+
+#include <private/qfilesystemmodel_p.h>
+
+#include <memory>
+
+using namespace Qt::StringLiterals;
+
+class MyFriendFileSystemModel : public QFileSystemModel
+{
+    friend class tst_bench_QFileSystemModel;
+    Q_DECLARE_PRIVATE(QFileSystemModel)
+};
+
+class tst_bench_QFileSystemModel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void removeRows_data();
+    void removeRows();
+
+    void childLookup_data();
+    void childLookup();
+
+    void paintDetailsView();
+
+    void scrollFlatDirectory();
+    void sortFlatDirectory_data();
+    void sortFlatDirectory();
+    void filterFlatDirectory();
+
+private:
+    QString flatDirectory();
+
+    QStringList fileNames;
+    QTemporaryDir tempDir;
+    std::unique_ptr<QTemporaryDir> flatDir;
+};
+
+static constexpr int FileCount = 20000;
+
+void tst_bench_QFileSystemModel::initTestCase()
+{
+    QVERIFY2(tempDir.isValid(), qPrintable(tempDir.errorString()));
+    for (int i = 0; i < FileCount; ++i) {
+        const QString name = u"file%1"_s.arg(i, 5, 10, QLatin1Char('0'));
+        QFile file(tempDir.filePath(name));
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+        fileNames << name;
+    }
+}
+
+void tst_bench_QFileSystemModel::removeRows_data()
+{
+    QTest::addColumn<bool>("batched");
+    QTest::addColumn<int>("stride");
+    QTest::addColumn<Qt::SortOrder>("order");
+
+    QTest::newRow("per file, contiguous") << false << 1 << Qt::AscendingOrder;
+    QTest::newRow("batched, contiguous") << true << 1 << Qt::AscendingOrder;
+    QTest::newRow("per file, contiguous, descending") << false << 1 << Qt::DescendingOrder;
+    QTest::newRow("batched, contiguous, descending") << true << 1 << Qt::DescendingOrder;
+    QTest::newRow("per file, every other") << false << 2 << Qt::AscendingOrder;
+    QTest::newRow("batched, every other") << true << 2 << Qt::AscendingOrder;
+}
+
+// Removing files from a watched directory shown in a view, as
+// directoryChanged() does when they are deleted or moved away
+void tst_bench_QFileSystemModel::removeRows()
+{
+    QFETCH(bool, batched);
+    QFETCH(int, stride);
+    QFETCH(Qt::SortOrder, order);
+
+    MyFriendFileSystemModel model;
+    const QModelIndex root = model.setRootPath(tempDir.path());
+    QTRY_COMPARE_WITH_TIMEOUT(model.rowCount(root), FileCount, 60000);
+    model.sort(0, order);
+
+    QTreeView view;
+    view.setUniformRowHeights(true);
+    view.setModel(&model);
+    view.setRootIndex(root);
+    view.resize(640, 480);
+    view.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&view));
+
+    QStringList toRemove;
+    for (int i = 0; i < FileCount; i += stride)
+        toRemove << fileNames.at(i);
+
+    QFileSystemModelPrivate *d = model.d_func();
+    QFileSystemModelPrivate::QFileSystemNode *parentNode = d->node(root);
+    QBENCHMARK_ONCE {
+        if (batched) {
+            d->removeNodes(parentNode, toRemove);
+        } else {
+            for (const QString &name : std::as_const(toRemove))
+                d->removeNode(parentNode, name);
+        }
+        QCoreApplication::processEvents();
+    }
+    QCOMPARE(model.rowCount(root), FileCount - toRemove.size());
+}
+
+void tst_bench_QFileSystemModel::childLookup_data()
+{
+    QTest::addColumn<bool>("otherCase");
+
+    QTest::newRow("same case") << false;
+    QTest::newRow("other case") << true;
+}
+
+// Looking up the children of a large directory by name, as node() and
+// fileSystemChanged() do. Names only match in another case on Windows.
+void tst_bench_QFileSystemModel::childLookup()
+{
+    QFETCH(bool, otherCase);
+
+    MyFriendFileSystemModel model;
+    const QModelIndex root = model.setRootPath(tempDir.path());
+    QTRY_COMPARE_WITH_TIMEOUT(model.rowCount(root), FileCount, 60000);
+
+    QStringList names = fileNames;
+    if (otherCase) {
+        for (QString &name : names)
+            name = name.toUpper();
+    }
+
+    QFileSystemModelPrivate *d = model.d_func();
+    const QFileSystemModelPrivate::QFileSystemNode *parentNode = d->node(root);
+    qsizetype found = 0;
+    QBENCHMARK {
+        found = 0;
+        for (const QString &name : std::as_const(names)) {
+            if (parentNode->children.contains(name))
+                ++found;
+        }
+    }
+#ifdef Q_OS_WIN
+    QCOMPARE(found, FileCount);
+#else
+    QCOMPARE(found, otherCase ? 0 : FileCount);
+#endif
+}
+
+// Repainting a details view of a 10k rows directory, which asks the
+// model for the data of every visible cell
+void tst_bench_QFileSystemModel::paintDetailsView()
+{
+    QTemporaryDir dir;
+    QVERIFY2(dir.isValid(), qPrintable(dir.errorString()));
+    const int rowCount = 10000;
+    for (int i = 0; i < rowCount; ++i) {
+        QFile file(dir.filePath(u"file%1.txt"_s.arg(i, 5, 10, QLatin1Char('0'))));
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+    }
+
+    QFileSystemModel model;
+    const QModelIndex root = model.setRootPath(dir.path());
+    QTRY_COMPARE_WITH_TIMEOUT(model.rowCount(root), rowCount, 60000);
+
+    QTreeView view;
+    view.setUniformRowHeights(true);
+    view.setRootIsDecorated(false);
+    view.setModel(&model);
+    view.setRootIndex(root);
+    view.header()->setSectionResizeMode(QHeaderView::Stretch);
+    view.resize(1024, 1024);
+    view.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&view));
+
+    QBENCHMARK {
+        view.viewport()->repaint();
+    }
+}
+
+static constexpr int FlatEntryCount = 1000000;
+
+// A single directory of a million empty files, as the asset browser shows,
+// created on first use and shared by the benchmarks below
+QString tst_bench_QFileSystemModel::flatDirectory()
+{
+    if (!flatDir) {
+        flatDir = std::make_unique<QTemporaryDir>();
+        if (!flatDir->isValid())
+            return QString();
+        for (int i = 0; i < FlatEntryCount; ++i) {
+            QFile file(flatDir->filePath(u"entry%1.%2"_s.arg(i, 7, 10, QLatin1Char('0'))
+                                         .arg(i % 4 ? "2da"_L1 : "tlk"_L1)));
+            if (!file.open(QIODevice::WriteOnly))
+                return QString();
+        }
+    }
+    return flatDir->path();
+}
+
+// Jumping through the whole directory in a details view, which asks for the
+// index, parent and data of every row that becomes visible
+void tst_bench_QFileSystemModel::scrollFlatDirectory()
+{
+    const QString dirPath = flatDirectory();
+    QVERIFY(!dirPath.isEmpty());
+
+    QFileSystemModel model;
+    const QModelIndex root = model.setRootPath(dirPath);
+    QTRY_COMPARE_WITH_TIMEOUT(model.rowCount(root), FlatEntryCount, 600000);
+    model.sort(0);
+
+    QTreeView view;
+    view.setUniformRowHeights(true);
+    view.setRootIsDecorated(false);
+    view.setModel(&model);
+    view.setRootIndex(root);
+    view.resize(1024, 1024);
+    view.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&view));
+
+    QScrollBar *scrollBar = view.verticalScrollBar();
+    const int steps = 100;
+    QBENCHMARK {
+        for (int step = 0; step <= steps; ++step) {
+            scrollBar->setValue(scrollBar->maximum() / steps * step);
+            view.viewport()->repaint();
+        }
+    }
+}
+
+void tst_bench_QFileSystemModel::sortFlatDirectory_data()
+{
+    QTest::addColumn<int>("column");
+
+    QTest::newRow("name") << 0;
+    QTest::newRow("size") << 1;
+    QTest::newRow("type") << 2;
+    QTest::newRow("time") << 3;
+}
+
+// Sorting the directory by a column, descending and then ascending again,
+// with a persistent index on a row as a view's current index would be.
+// sort() only maps the rows again when just the order changes, forceSort
+// makes both calls sort the children as a change of the filters would.
+void tst_bench_QFileSystemModel::sortFlatDirectory()
+{
+    QFETCH(int, column);
+    const QString dirPath = flatDirectory();
+    QVERIFY(!dirPath.isEmpty());
+
+    MyFriendFileSystemModel model;
+    const QModelIndex root = model.setRootPath(dirPath);
+    QTRY_COMPARE_WITH_TIMEOUT(model.rowCount(root), FlatEntryCount, 600000);
+    model.sort(column);
+    const QPersistentModelIndex current = model.index(FlatEntryCount / 2, 0, root);
+    const QString currentName = model.fileName(current);
+
+    QFileSystemModelPrivate *d = model.d_func();
+    QBENCHMARK {
+        d->forceSort = true;
+        model.sort(column, Qt::DescendingOrder);
+        d->forceSort = true;
+        model.sort(column, Qt::AscendingOrder);
+    }
+    QCOMPARE(model.fileName(current), currentName);
+}
+
+// Hiding three quarters of the directory with a name filter, and showing
+// them again
+void tst_bench_QFileSystemModel::filterFlatDirectory()
+{
+    const QString dirPath = flatDirectory();
+    QVERIFY(!dirPath.isEmpty());
+
+    QFileSystemModel model;
+    model.setNameFilterDisables(false);
+    const QModelIndex root = model.setRootPath(dirPath);
+    QTRY_COMPARE_WITH_TIMEOUT(model.rowCount(root), FlatEntryCount, 600000);
+    model.sort(0);
+
+    // sort() applies the filters right away, as the delayed sort would
+    QBENCHMARK {
+        model.setNameFilters({ u"*.tlk"_s });
+        model.sort(0);
+        QCOMPARE(model.rowCount(root), FlatEntryCount / 4);
+        model.setNameFilters({});
+        model.sort(0);
+        QCOMPARE(model.rowCount(root), FlatEntryCount);
+    }
+}
+
+QTEST_MAIN(tst_bench_QFileSystemModel)
+#include "tst_bench_qfilesystemmodel.moc"
@@ -20,7 +20,10 @@
 #include <QStyle>
 #include <QtGlobal>
 #include <QTemporaryDir>
+#include <QThread>
 #include <QAbstractItemModelTester>
+#include <QRegularExpression>
+#include <QMimeData>
 #if defined(Q_OS_WIN)
 # include <qt_windows.h> // for SetFileAttributes
 #endif
@@ -28,6 +31,8 @@
 #include <private/qfilesystemengine_p.h>
 
 #include <algorithm>
+#include <memory>
+#include <vector>
 
 using namespace Qt::StringLiterals;
 using namespace std::chrono;
@@ -62,11 +67,13 @@ private slots:
     void cleanup();
 
     void indexPath();
+    void indexPathAfterRename();
 
     void rootPath();
     void readOnly();
     void iconProvider();
     void nullIconProvider();
+    void retranslateTypes();
 
     void rowCount();
 
@@ -85,19 +92,55 @@ private slots:
     void showFilesOnly();
 
     void nameFilters();
+    void nameFilterBypass();
+#ifdef QT_BUILD_INTERNAL
+    void nameFilterMatcher_data();
+    void nameFilterMatcher();
+#endif
 
     void setData_data();
     void setData();
 
     void sortPersistentIndex();
+    void sortPersistentIndexes();
+    void visibleRows();
     void sort_data();
     void sort();
+#ifdef QT_BUILD_INTERNAL
+    void virtualizedDirectory();
+    void displayStrings();
+#endif
+    void memoryBudget();
+    void virtualizedMemoryBudget();
+    void directorySizes();
+#ifdef QT_BUILD_INTERNAL
+    void directorySizesBeforeListing();
+#endif
+    void search();
+    void indexes();
+    void snapshot();
+    void publishedTree();
+#ifdef QT_BUILD_INTERNAL
+    void removeNodesInRanges_data();
+    void removeNodesInRanges();
+#endif
 
     void mkdir();
     void deleteFile();
+    void asynchronousDrop_data();
+    void asynchronousDrop();
+    void asynchronousDropConflict();
+    void asynchronousRemove();
+#ifdef QT_BUILD_INTERNAL
+    void fileOperationsOnUnloadedDirectories();
+#endif
     void deleteDirectory();
 
     void caseSensitivity();
+    void caseInsensitiveNames();
+#ifdef QT_BUILD_INTERNAL
+    void nodePathKeyHash();
+#endif
 
     void drives_data();
     void drives();
@@ -105,6 +148,8 @@ private slots:
 
     void roleNames_data();
     void roleNames();
+    void multiData();
+    void mimeData();
 
     void permissions_data();
     void permissions();
@@ -174,6 +219,28 @@ void tst_QFileSystemModel::indexPath()
 #endif
 }
 
+void tst_QFileSystemModel::indexPathAfterRename()
+{
+    const QString tmp = flatDirTestPath;
+    QFileSystemModel model;
+    QAbstractItemModelTester tester(&model);
+    tester.setUseFetchMore(false);
+    QVERIFY(createFiles(&model, tmp, QStringList{u"a"_s, u"b"_s}));
+    const QModelIndex root = model.setRootPath(tmp);
+    QTRY_COMPARE(model.rowCount(root), 2);
+
+    const QString oldPath = tmp + u"/a"_s;
+    const QModelIndex idx = model.index(oldPath);
+    QVERIFY(idx.isValid());
+    // the second lookup is answered by the path cache
+    QCOMPARE(model.index(oldPath), idx);
+
+    model.setReadOnly(false);
+    QVERIFY(model.setData(idx, u"c"_s));
+    QCOMPARE(model.index(tmp + u"/c"_s), idx);
+    QVERIFY(!model.index(oldPath).isValid());
+}
+
 void tst_QFileSystemModel::rootPath()
 {
     QScopedPointer<QFileSystemModel> model(new QFileSystemModel);
@@ -332,6 +399,50 @@ void tst_QFileSystemModel::nullIconProvider()
     model.setRootPath(documentPaths.constFirst());
 }
 
+class TypeNameIconProvider : public QFileIconProvider
+{
+public:
+    QString type(const QFileInfo &) const override
+    {
+        ++calls;
+        return typeName;
+    }
+
+    QString typeName = u"before"_s;
+    mutable int calls = 0;
+};
+
+void tst_QFileSystemModel::retranslateTypes()
+{
+    QTemporaryDir tempDir;
+    QVERIFY2(tempDir.isValid(), qPrintable(tempDir.errorString()));
+    const QString dirPath = tempDir.path();
+    for (const char *name : {"a.txt", "b.txt", "c.txt"}) {
+        QFile file(dirPath + u'/' + QLatin1StringView(name));
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+    }
+
+    TypeNameIconProvider provider;
+    QFileSystemModel model;
+    model.setIconProvider(&provider);
+    const QModelIndex root = model.setRootPath(dirPath);
+    QTRY_COMPARE(model.rowCount(root), 3);
+    const QModelIndex a = model.index(dirPath + u"/a.txt"_s);
+    QCOMPARE(model.type(a), u"before"_s);
+
+    // Only the items that are asked for are resolved again
+    provider.typeName = u"after"_s;
+    provider.calls = 0;
+    QEvent languageChange(QEvent::LanguageChange);
+    QCoreApplication::sendEvent(&model, &languageChange);
+    QCOMPARE(provider.calls, 0);
+    QCOMPARE(model.type(a), u"after"_s);
+    QCOMPARE(provider.calls, 1);
+    QCOMPARE(model.type(a), u"after"_s);
+    QCOMPARE(provider.calls, 1);
+    QCOMPARE(model.index(dirPath + u"/b.txt"_s).siblingAtColumn(2).data().toString(), u"after"_s);
+}
+
 bool tst_QFileSystemModel::createFiles(QFileSystemModel *model, const QString &test_path,
                                        const QStringList &initial_files, int existingFileCount,
                                        const QStringList &initial_dirs)
@@ -750,7 +861,92 @@ void tst_QFileSystemModel::nameFilters()
     filters << "a" << "b";
     model->setNameFilters(filters);
     QTRY_COMPARE(model->rowCount(root), 2);
+
+    // Asking for a filtered out file shows it until the filters change again
+    const QModelIndex c = model->index(tmp + "/c");
+    QVERIFY(c.isValid());
+    QCOMPARE(model->rowCount(root), 3);
+    model->setNameFilters(filters);
+    QTRY_COMPARE(model->rowCount(root), 2);
+}
+
+// Directories that were asked for are filtered again too, but for the ones
+// above a persistent index
+void tst_QFileSystemModel::nameFilterBypass()
+{
+    QTemporaryDir tempDir;
+    QVERIFY2(tempDir.isValid(), qPrintable(tempDir.errorString()));
+    const QString dirPath = tempDir.path();
+    QDir dir(dirPath);
+    QVERIFY(dir.mkdir(u"kept"_s));
+    QVERIFY(dir.mkdir(u"dropped"_s));
+    {
+        QFile file(dirPath + u"/a.txt"_s);
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+    }
+
+    QFileSystemModel model;
+    // without AllDirs, the name filters apply to directories as well
+    model.setFilter(QDir::AllEntries | QDir::NoDotAndDotDot);
+    model.setNameFilterDisables(false);
+    model.setNameFilters({ u"*.txt"_s });
+    const QModelIndex root = model.setRootPath(dirPath);
+    QTRY_COMPARE(model.rowCount(root), 1);
+
+    const QPersistentModelIndex kept = model.index(dirPath + u"/kept"_s);
+    QVERIFY(kept.isValid());
+    QVERIFY(model.index(dirPath + u"/dropped"_s).isValid());
+    QCOMPARE(model.rowCount(root), 3);
+
+    model.setNameFilters({ u"*.txt"_s });
+    QTRY_COMPARE(model.rowCount(root), 2);
+    QVERIFY(kept.isValid());
+    QCOMPARE(kept.data().toString(), u"kept"_s);
 }
+
+#ifdef QT_BUILD_INTERNAL
+void tst_QFileSystemModel::nameFilterMatcher_data()
+{
+    QTest::addColumn<QStringList>("nameFilters");
+    QTest::addColumn<Qt::CaseSensitivity>("cs");
+    QTest::addColumn<QString>("fileName");
+    QTest::addColumn<bool>("matches");
+
+    const QStringList resources{u"*.2da"_s, u"*.tpc"_s, u"*.tga"_s, u"*.mdl"_s,
+                                u"dialog.tlk"_s, u"*.?rf"_s};
+    QTest::newRow("suffix") << resources << Qt::CaseInsensitive << u"appearance.2da"_s << true;
+    QTest::newRow("suffix, other case") << resources << Qt::CaseInsensitive << u"C_DROID.TPC"_s << true;
+    QTest::newRow("suffix, case sensitive") << resources << Qt::CaseSensitive << u"C_DROID.TPC"_s << false;
+    QTest::newRow("suffix prefix only") << resources << Qt::CaseInsensitive << u"c_droid.tpcx"_s << false;
+    QTest::newRow("literal") << resources << Qt::CaseInsensitive << u"dialog.tlk"_s << true;
+    QTest::newRow("wildcard") << resources << Qt::CaseInsensitive << u"danm13.erf"_s << true;
+    QTest::newRow("no match") << resources << Qt::CaseInsensitive << u"readme.txt"_s << false;
+    QTest::newRow("no dot") << resources << Qt::CaseInsensitive << u"tpc"_s << false;
+    QTest::newRow("double suffix") << QStringList{u"*.tar.gz"_s} << Qt::CaseInsensitive << u"mod.tar.gz"_s << true;
+    QTest::newRow("double suffix, other case") << QStringList{u"*.tar.gz"_s} << Qt::CaseInsensitive << u"MOD.Tar.GZ"_s << true;
+    QTest::newRow("hidden file") << QStringList{u"*.ini"_s} << Qt::CaseInsensitive << u".ini"_s << true;
+    QTest::newRow("any") << QStringList{u"*"_s} << Qt::CaseSensitive << u"swkotor.exe"_s << true;
+}
+
+void tst_QFileSystemModel::nameFilterMatcher()
+{
+    QFETCH(QStringList, nameFilters);
+    QFETCH(Qt::CaseSensitivity, cs);
+    QFETCH(QString, fileName);
+    QFETCH(bool, matches);
+
+    const QFileNameFilterMatcher matcher(nameFilters, cs);
+    QCOMPARE(matcher.matches(fileName), matches);
+
+    // must agree with matching each filter on its own
+    const bool anyMatches = std::any_of(nameFilters.cbegin(), nameFilters.cend(),
+                                        [&](const QString &nameFilter) {
+        return fileName.contains(QRegularExpression::fromWildcard(nameFilter, cs));
+    });
+    QCOMPARE(anyMatches, matches);
+}
+#endif
+
 void tst_QFileSystemModel::setData_data()
 {
     QTest::addColumn<QString>("subdirName");
@@ -850,6 +1046,91 @@ void tst_QFileSystemModel::sortPersistentIndex()
     QVERIFY(idx.column() != 0);
 }
 
+void tst_QFileSystemModel::sortPersistentIndexes()
+{
+    QTemporaryDir tempDir;
+    QVERIFY2(tempDir.isValid(), qPrintable(tempDir.errorString()));
+    const QString dirPath = tempDir.path();
+    const int fileCount = 20;
+    for (int i = 0; i < fileCount; ++i) {
+        QFile file(dirPath + u"/file"_s + QString::number(i));
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+    }
+    QFileSystemModel model;
+    const QModelIndex root = model.setRootPath(dirPath);
+    QTRY_COMPARE(model.rowCount(root), fileCount);
+    model.sort(0, Qt::AscendingOrder);
+
+    QList<QPersistentModelIndex> indexes;
+    QStringList names;
+    for (int row = 0; row < fileCount; ++row) {
+        for (int column = 0; column < 2; ++column) {
+            const QModelIndex index = model.index(row, column, root);
+            indexes << index;
+            names << model.fileName(index);
+        }
+    }
+
+    model.sort(0, Qt::DescendingOrder);
+    for (qsizetype i = 0; i < indexes.size(); ++i) {
+        QCOMPARE(indexes.at(i).row(), fileCount - 1 - int(i / 2));
+        QCOMPARE(indexes.at(i).column(), int(i % 2));
+        QCOMPARE(model.fileName(indexes.at(i)), names.at(i));
+    }
+
+    model.sort(2, Qt::AscendingOrder);
+    for (qsizetype i = 0; i < indexes.size(); ++i)
+        QCOMPARE(model.fileName(indexes.at(i)), names.at(i));
+}
+
+// The rows of index(path) and parent() come from a row cached in the nodes,
+// which must follow sorting, removals and filtering
+void tst_QFileSystemModel::visibleRows()
+{
+    QTemporaryDir tempDir;
+    QVERIFY2(tempDir.isValid(), qPrintable(tempDir.errorString()));
+    const QString dirPath = tempDir.path();
+    QVERIFY(QDir(dirPath).mkdir(u"sub"_s));
+    const int fileCount = 40;
+    for (int i = 0; i < fileCount; ++i) {
+        QFile file(dirPath + u"/sub/file"_s + QString::number(i) + (i % 3 ? u".mod"_s : u".tlk"_s));
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+    }
+    QFileSystemModel model;
+    model.setNameFilterDisables(false);
+    const QModelIndex root = model.setRootPath(dirPath);
+    const QModelIndex sub = model.index(dirPath + u"/sub"_s);
+    model.fetchMore(sub);
+    QTRY_COMPARE(model.rowCount(sub), fileCount);
+
+    const auto verifyRows = [&] {
+        for (int row = 0; row < model.rowCount(sub); ++row) {
+            const QModelIndex index = model.index(row, 0, sub);
+            if (model.index(model.filePath(index)) != index || model.parent(index) != sub)
+                return false;
+        }
+        return model.index(dirPath + u"/sub"_s) == sub && model.parent(sub) == root;
+    };
+    model.sort(0, Qt::AscendingOrder);
+    QVERIFY(verifyRows());
+    model.sort(0, Qt::DescendingOrder);
+    QVERIFY(verifyRows());
+    model.sort(1, Qt::AscendingOrder);
+    QVERIFY(verifyRows());
+
+    for (int i = 0; i < fileCount; i += 4)
+        QVERIFY(QFile::remove(dirPath + u"/sub/file"_s + QString::number(i) + (i % 3 ? u".mod"_s : u".tlk"_s)));
+    QTRY_COMPARE(model.rowCount(sub), fileCount - fileCount / 4);
+    QVERIFY(verifyRows());
+
+    model.setNameFilters({ u"*.tlk"_s });
+    QTRY_VERIFY(model.rowCount(sub) < fileCount / 2);
+    QVERIFY(verifyRows());
+    model.setNameFilters({});
+    QTRY_COMPARE(model.rowCount(sub), fileCount - fileCount / 4);
+    QVERIFY(verifyRows());
+}
+
 class MyFriendFileSystemModel : public QFileSystemModel
 {
     friend class tst_QFileSystemModel;
@@ -942,6 +1223,466 @@ void tst_QFileSystemModel::sort()
     }
 }
 
+#ifdef QT_BUILD_INTERNAL
+void tst_QFileSystemModel::virtualizedDirectory()
+{
+    QTemporaryDir tempDir;
+    QVERIFY2(tempDir.isValid(), qPrintable(tempDir.errorString()));
+    const QString dirPath = tempDir.path();
+    const int fileCount = 30;
+    QStringList expected;
+    for (int i = 0; i < fileCount; ++i) {
+        const QString name = u"file%1.txt"_s.arg(i, 2, 10, QLatin1Char('0'));
+        QFile file(dirPath + u'/' + name);
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+        expected << name;
+    }
+
+    QScopedPointer<MyFriendFileSystemModel> model(new MyFriendFileSystemModel);
+    model->setVirtualizationThreshold(10);
+    QCOMPARE(model->virtualizationThreshold(), 10);
+    const QModelIndex root = model->setRootPath(dirPath);
+    QTRY_COMPARE(model->rowCount(root), fileCount);
+
+    // Only the entries exist until the rows are asked for
+    const QFileSystemModelPrivate::QFileSystemNode *dirNode = model->d_func()->node(root);
+    QVERIFY(dirNode->entries);
+    QCOMPARE(dirNode->entries->size(), fileCount);
+    QVERIFY(dirNode->children.size() < fileCount);
+
+    model->sort(0, Qt::AscendingOrder);
+    QStringList names;
+    for (int i = 0; i < model->rowCount(root); ++i) {
+        const QModelIndex index = model->index(i, 0, root);
+        QCOMPARE(model->filePath(index), dirPath + u'/' + index.data().toString());
+        names << index.data().toString();
+    }
+    QCOMPARE(names, expected);
+    QCOMPARE(dirNode->children.size(), fileCount);
+    // the nodes are made from the entries, the rest is fetched in the background
+    for (int i = 0; i < model->rowCount(root); ++i)
+        QTRY_VERIFY(model->fileInfo(model->index(i, 0, root)).isFile());
+    QCOMPARE(model->index(dirPath + u"/file07.txt"_s).row(), 7);
+}
+
+void tst_QFileSystemModel::displayStrings()
+{
+    QTemporaryDir tempDir;
+    QVERIFY2(tempDir.isValid(), qPrintable(tempDir.errorString()));
+    const QString dirPath = tempDir.path();
+    for (const char *name : {"a.txt", "b.txt"}) {
+        QFile file(dirPath + u'/' + QLatin1StringView(name));
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+        QCOMPARE(file.write(QByteArray(100, 'x')), 100);
+    }
+
+    QScopedPointer<MyFriendFileSystemModel> model(new MyFriendFileSystemModel);
+    const QModelIndex root = model->setRootPath(dirPath);
+    QTRY_COMPARE(model->rowCount(root), 2);
+    const QModelIndex a = model->index(dirPath + u"/a.txt"_s, 1);
+    const QModelIndex b = model->index(dirPath + u"/b.txt"_s, 1);
+    QFileSystemModelPrivate *d = model->d_func();
+    QVERIFY(!d->node(a)->displayStrings);
+    QVERIFY(!d->node(b)->displayStrings);
+
+    // Only built for the cells that are asked for
+    const QString size = QLocale::system().formattedDataSize(100);
+    QCOMPARE(a.data().toString(), size);
+    QVERIFY(d->node(a)->displayStrings);
+    QCOMPARE(d->node(a)->displayStrings->size, size);
+    QVERIFY(!d->node(b)->displayStrings);
+    const QString time = a.siblingAtColumn(3).data().toString();
+    QCOMPARE(d->node(a)->displayStrings->time, time);
+
+    // Rebuilt once the system locale is not the one they were built for
+    const quint32 generation = d->localeGeneration;
+    d->displayLanguage = QLocale::Klingon;
+    QCOMPARE(a.data().toString(), size);
+    QCOMPARE(d->displayLanguage, QLocale::system().language());
+    QVERIFY(d->localeGeneration != generation);
+    QCOMPARE(d->node(a)->displayStrings->localeGeneration, d->localeGeneration);
+    QVERIFY(d->node(a)->displayStrings->time.isNull());
+}
+#endif
+
+void tst_QFileSystemModel::memoryBudget()
+{
+    QTemporaryDir tempDir;
+    QVERIFY2(tempDir.isValid(), qPrintable(tempDir.errorString()));
+    const QString dirPath = tempDir.path();
+    const int fileCount = 20;
+    for (const QString &subdir : {u"a"_s, u"b"_s}) {
+        QVERIFY(QDir(dirPath).mkdir(subdir));
+        for (int i = 0; i < fileCount; ++i) {
+            QFile file(dirPath + u'/' + subdir + u"/file"_s + QString::number(i));
+            QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+        }
+    }
+
+    QFileSystemModel model;
+    QCOMPARE(model.memoryBudget(), qint64(0));
+    const QModelIndex root = model.setRootPath(dirPath);
+    QTRY_COMPARE(model.rowCount(root), 2);
+    const QModelIndex a = model.index(dirPath + u"/a"_s);
+    const QModelIndex b = model.index(dirPath + u"/b"_s);
+    model.fetchMore(a);
+    model.fetchMore(b);
+    QTRY_COMPARE(model.rowCount(a), fileCount);
+    QTRY_COMPARE(model.rowCount(b), fileCount);
+    const qint64 loadedNodes = model.nodeCount();
+    QVERIFY(loadedNodes >= 2 * fileCount + 2);
+    QVERIFY(model.memoryUsage() > 0);
+
+    // b is in use, a is not
+    const QPersistentModelIndex used = model.index(0, 0, b);
+    QSignalSpy removedSpy(&model, &QAbstractItemModel::rowsRemoved);
+    model.setMemoryBudget(1);
+    QTRY_COMPARE(model.rowCount(a), 0);
+    QCOMPARE(removedSpy.size(), 1);
+    QVERIFY(model.canFetchMore(a));
+    QCOMPARE(model.rowCount(b), fileCount);
+    QVERIFY(used.isValid());
+    QCOMPARE(model.rowCount(root), 2);
+    QCOMPARE(model.nodeCount(), loadedNodes - fileCount);
+
+    // a is listed again when asked for
+    model.setMemoryBudget(0);
+    model.fetchMore(a);
+    QTRY_COMPARE(model.rowCount(a), fileCount);
+}
+
+void tst_QFileSystemModel::virtualizedMemoryBudget()
+{
+    QTemporaryDir tempDir;
+    QVERIFY2(tempDir.isValid(), qPrintable(tempDir.errorString()));
+    const QString dirPath = tempDir.path();
+    const int fileCount = 500;
+    QVERIFY(QDir(dirPath).mkdir(u"a"_s));
+    for (int i = 0; i < fileCount; ++i) {
+        QFile file(dirPath + u"/a/file"_s + QString::number(i));
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+    }
+
+    QFileSystemModel model;
+    model.setVirtualizationThreshold(10);
+    const QModelIndex root = model.setRootPath(dirPath);
+    QTRY_COMPARE(model.rowCount(root), 1);
+    const QModelIndex a = model.index(dirPath + u"/a"_s);
+    const qint64 unlisted = model.memoryUsage();
+
+    // the entries are counted, not only the few nodes
+    model.fetchMore(a);
+    QTRY_COMPARE(model.rowCount(a), fileCount);
+    QVERIFY(model.memoryUsage() - unlisted > fileCount * 2 * qint64(sizeof(QString)));
+
+    // and freed with the directory
+    model.setMemoryBudget(1);
+    QTRY_COMPARE(model.rowCount(a), 0);
+    QCOMPARE(model.memoryUsage(), unlisted);
+}
+
+void tst_QFileSystemModel::directorySizes()
+{
+    QTemporaryDir tempDir;
+    QVERIFY2(tempDir.isValid(), qPrintable(tempDir.errorString()));
+    const QString dirPath = tempDir.path();
+    QVERIFY(QDir(dirPath).mkpath(u"a/b"_s));
+    const auto writeFile = [](const QString &path, qsizetype size) {
+        QFile file(path);
+        return file.open(QIODevice::WriteOnly) && file.write(QByteArray(size, 'x')) == size;
+    };
+    QVERIFY(writeFile(dirPath + u"/a/file1"_s, 100));
+    QVERIFY(writeFile(dirPath + u"/a/b/file2"_s, 200));
+
+    QFileSystemModel model;
+    model.setOption(QFileSystemModel::ComputeDirectorySizes);
+    QVERIFY(model.testOption(QFileSystemModel::ComputeDirectorySizes));
+    const QModelIndex root = model.setRootPath(dirPath);
+    QTRY_COMPARE(model.rowCount(root), 1);
+    const QModelIndex a = model.index(dirPath + u"/a"_s);
+    QTRY_COMPARE(model.size(a), qint64(300));
+    QCOMPARE(model.itemCount(a), qint64(3));
+    QCOMPARE(model.itemCount(model.index(dirPath + u"/a/file1"_s)), qint64(-1));
+
+    // listed directories follow changes reported by the watcher
+    model.fetchMore(a);
+    QTRY_COMPARE(model.rowCount(a), 2);
+    QVERIFY(writeFile(dirPath + u"/a/file3"_s, 50));
+    QTRY_COMPARE(model.size(a), qint64(350));
+    QCOMPARE(model.itemCount(a), qint64(4));
+
+    model.setOption(QFileSystemModel::ComputeDirectorySizes, false);
+    QCOMPARE(model.itemCount(a), qint64(-1));
+}
+
+#ifdef QT_BUILD_INTERNAL
+// Fetching the information of a file doesn't list its directory: the
+// files of the first listing are not counted again
+void tst_QFileSystemModel::directorySizesBeforeListing()
+{
+    QTemporaryDir tempDir;
+    QVERIFY2(tempDir.isValid(), qPrintable(tempDir.errorString()));
+    const QString dirPath = tempDir.path();
+    QVERIFY(QDir(dirPath).mkpath(u"a/b"_s));
+    const auto writeFile = [](const QString &path, qsizetype size) {
+        QFile file(path);
+        return file.open(QIODevice::WriteOnly) && file.write(QByteArray(size, 'x')) == size;
+    };
+    QVERIFY(writeFile(dirPath + u"/a/file1"_s, 100));
+    QVERIFY(writeFile(dirPath + u"/a/b/file2"_s, 200));
+
+    MyFriendFileSystemModel model;
+    model.setOption(QFileSystemModel::ComputeDirectorySizes);
+    const QModelIndex root = model.setRootPath(dirPath);
+    QTRY_COMPARE(model.rowCount(root), 1);
+    const QModelIndex a = model.index(dirPath + u"/a"_s);
+    QTRY_COMPARE(model.size(a), qint64(300));
+
+    QSignalSpy loadedSpy(&model, &QFileSystemModel::directoryLoaded);
+    model.d_func()->fileInfoGatherer->fetchExtendedInformation(dirPath + u"/a"_s,
+                                                               { u"file1"_s });
+    QTRY_VERIFY(loadedSpy.contains({ dirPath + u"/a"_s }));
+    QVERIFY(!model.d_func()->node(a)->listed);
+
+    model.fetchMore(a);
+    QTRY_COMPARE(model.rowCount(a), 2);
+    QTRY_VERIFY(model.d_func()->node(a)->listed);
+    QCOMPARE(model.size(a), qint64(300));
+    QCOMPARE(model.itemCount(a), qint64(3));
+}
+#endif
+
+void tst_QFileSystemModel::search()
+{
+    QTemporaryDir tempDir;
+    QVERIFY2(tempDir.isValid(), qPrintable(tempDir.errorString()));
+    const QString dirPath = tempDir.path();
+    QVERIFY(QDir(dirPath).mkdir(u"sub"_s));
+    const QStringList files = { u"alpha.txt"_s, u"Beta.TXT"_s, u"sub/gamma.txt"_s, u"sub/alphabet.dat"_s };
+    for (const QString &name : files) {
+        QFile file(dirPath + u'/' + name);
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+    }
+
+    QFileSystemModel model;
+    const QModelIndex root = model.setRootPath(dirPath);
+    QTRY_COMPARE(model.rowCount(root), 3);
+    const QModelIndex sub = model.index(dirPath + u"/sub"_s);
+    model.fetchMore(sub);
+    QTRY_COMPARE(model.rowCount(sub), 2);
+
+    const auto names = [&model](const QModelIndexList &indexes) {
+        QStringList result;
+        for (const QModelIndex &index : indexes)
+            result << model.fileName(index);
+        result.sort();
+        return result;
+    };
+    QCOMPARE(names(model.search(u"ALPHA"_s)), QStringList({ u"alpha.txt"_s, u"alphabet.dat"_s }));
+    QCOMPARE(names(model.search(u".txt"_s)),
+             QStringList({ u"Beta.TXT"_s, u"alpha.txt"_s, u"gamma.txt"_s }));
+    QCOMPARE(names(model.search(u"Ta"_s)), QStringList({ u"Beta.TXT"_s }));
+    QCOMPARE(model.search(u".txt"_s, 1).size(), 1);
+    QVERIFY(model.search(u"missing"_s).isEmpty());
+    const QModelIndexList gamma = model.search(u"gamma"_s);
+    QCOMPARE(gamma.size(), 1);
+    QCOMPARE(gamma.constFirst().parent(), sub);
+
+    // the index follows the file system
+    {
+        QFile file(dirPath + u"/sub/alphanumeric"_s);
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+    }
+    QVERIFY(QFile::remove(dirPath + u"/alpha.txt"_s));
+    QTRY_COMPARE(names(model.search(u"alpha"_s)),
+                 QStringList({ u"alphabet.dat"_s, u"alphanumeric"_s }));
+
+    // files hidden by the filters are not found
+    model.setNameFilterDisables(false);
+    model.setNameFilters({ u"*.dat"_s });
+    QTRY_COMPARE(names(model.search(u"alpha"_s)), QStringList({ u"alphabet.dat"_s }));
+}
+
+void tst_QFileSystemModel::indexes()
+{
+    QTemporaryDir tempDir;
+    QVERIFY2(tempDir.isValid(), qPrintable(tempDir.errorString()));
+    const QString dirPath = tempDir.path();
+    QVERIFY(QDir(dirPath).mkdir(u"sub"_s));
+    QStringList paths;
+    for (const QString &name : { u"c"_s, u"a"_s, u"sub/b"_s, u"b"_s }) {
+        QFile file(dirPath + u'/' + name);
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+        paths << dirPath + u'/' + name;
+    }
+    paths << dirPath + u"/missing"_s << QString() << dirPath + u"/sub/../a"_s << dirPath;
+    // a sibling of sub, resolved from their common directory
+    QVERIFY(QDir(dirPath).mkpath(u"sub-2/d"_s));
+    paths << dirPath + u"/sub-2/d"_s << dirPath + u"/sub-2/missing"_s;
+
+    QFileSystemModel model;
+    model.setRootPath(dirPath);
+    const QModelIndexList indexes = model.indexes(paths, 1);
+    QCOMPARE(indexes.size(), paths.size());
+    for (qsizetype i = 0; i < paths.size(); ++i)
+        QCOMPARE(indexes.at(i), model.index(paths.at(i), 1));
+    QVERIFY(indexes.at(0).isValid());
+    QCOMPARE(indexes.at(0).column(), 1);
+    QCOMPARE(indexes.at(2).parent(), model.index(dirPath + u"/sub"_s));
+    QVERIFY(!indexes.at(4).isValid());
+    QCOMPARE(indexes.at(6), indexes.at(1));
+    QCOMPARE(model.fileName(indexes.at(8).parent()), u"sub-2"_s);
+    QVERIFY(!indexes.at(9).isValid());
+}
+
+void tst_QFileSystemModel::snapshot()
+{
+    QTemporaryDir tempDir;
+    QVERIFY2(tempDir.isValid(), qPrintable(tempDir.errorString()));
+    const QString dirPath = tempDir.path() + u"/tree"_s;
+    QVERIFY(QDir().mkpath(dirPath + u"/sub"_s));
+    for (const QString &name : { u"a"_s, u"b"_s, u"sub/c"_s }) {
+        QFile file(dirPath + u'/' + name);
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+        file.write(name.toUtf8());
+    }
+    const QString snapshotPath = tempDir.path() + u"/snapshot"_s;
+    {
+        QFileSystemModel model;
+        const QModelIndex root = model.setRootPath(dirPath);
+        QTRY_COMPARE(model.rowCount(root), 3);
+        const QModelIndex sub = model.index(dirPath + u"/sub"_s);
+        model.fetchMore(sub);
+        QTRY_COMPARE(model.rowCount(sub), 1);
+        QVERIFY(model.saveSnapshot(snapshotPath));
+    }
+
+    // not part of the snapshot
+    {
+        QFile file(dirPath + u"/d"_s);
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+    }
+
+    QFileSystemModel model;
+    QVERIFY(!model.loadSnapshot(dirPath + u"/a"_s));
+    QVERIFY(model.loadSnapshot(snapshotPath));
+    QSignalSpy loadedSpy(&model, &QFileSystemModel::directoryLoaded);
+    const QModelIndex root = model.setRootPath(dirPath);
+    QCOMPARE(model.rowCount(root), 3);
+    for (int row = 0; row < 3; ++row)
+        QVERIFY(model.fileName(model.index(row, 0, root)) != u"d"_s);
+    QTRY_COMPARE(loadedSpy.size(), 1);
+    const QModelIndex sub = model.index(dirPath + u"/sub"_s);
+    QVERIFY(model.isDir(sub));
+    model.fetchMore(sub);
+    QCOMPARE(model.rowCount(sub), 1);
+    const QModelIndex c = model.index(0, 0, sub);
+    QCOMPARE(model.fileName(c), u"c"_s);
+    QCOMPARE(model.size(c), qint64(5));
+}
+
+void tst_QFileSystemModel::publishedTree()
+{
+    QTemporaryDir tempDir;
+    QVERIFY2(tempDir.isValid(), qPrintable(tempDir.errorString()));
+    const QString dirPath = tempDir.path();
+    QVERIFY(QDir(dirPath).mkdir(u"sub"_s));
+    {
+        QFile file(dirPath + u"/a"_s);
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+        file.write("abc");
+    }
+
+    QVERIFY(QFileSystemModelTree().isNull());
+    QFileSystemModel model;
+    QVERIFY(!model.publishedTree().isNull());
+    const QModelIndex root = model.setRootPath(dirPath);
+    QTRY_COMPARE(model.rowCount(root), 2);
+    QTRY_VERIFY(model.publishedTree().isListed(dirPath));
+
+    const QFileSystemModelTree first = model.publishedTree();
+    QCOMPARE(model.publishedTree().version(), first.version());
+    QVERIFY(first.exists(dirPath + u"/a"_s));
+    QVERIFY(!first.isDir(dirPath + u"/a"_s));
+    QCOMPARE(first.size(dirPath + u"/a"_s), qint64(3));
+    QCOMPARE(first.lastModified(dirPath + u"/a"_s),
+             QFileInfo(dirPath + u"/a"_s).lastModified(QTimeZone::UTC));
+    QVERIFY(first.isDir(dirPath + u"/sub"_s));
+    QVERIFY(!first.exists(dirPath + u"/b"_s));
+    QStringList entries = first.entryList(dirPath);
+    entries.sort();
+    QCOMPARE(entries, QStringList({ u"a"_s, u"sub"_s }));
+
+    // readable from another thread
+    bool existsInThread = false;
+    QScopedPointer<QThread> thread(QThread::create([first, &existsInThread, dirPath] {
+        existsInThread = first.exists(dirPath + u"/a"_s);
+    }));
+    thread->start();
+    QVERIFY(thread->wait());
+    QVERIFY(existsInThread);
+
+    // published trees don't change, new ones follow the model
+    {
+        QFile file(dirPath + u"/b"_s);
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+    }
+    QTRY_VERIFY(model.publishedTree().exists(dirPath + u"/b"_s));
+    QVERIFY(!first.exists(dirPath + u"/b"_s));
+    QVERIFY(model.publishedTree().version() > first.version());
+}
+
+#ifdef QT_BUILD_INTERNAL
+void tst_QFileSystemModel::removeNodesInRanges_data()
+{
+    QTest::addColumn<Qt::SortOrder>("order");
+    QTest::addColumn<QList<std::pair<int, int>>>("expectedRanges");
+    QTest::newRow("ascending") << Qt::AscendingOrder
+                               << QList<std::pair<int, int>>{ { 8, 8 }, { 0, 4 } };
+    QTest::newRow("descending") << Qt::DescendingOrder
+                                << QList<std::pair<int, int>>{ { 5, 9 }, { 1, 1 } };
+}
+
+void tst_QFileSystemModel::removeNodesInRanges()
+{
+    QFETCH(Qt::SortOrder, order);
+    QFETCH(QList<std::pair<int, int>>, expectedRanges);
+
+    QTemporaryDir tempDir;
+    QVERIFY2(tempDir.isValid(), qPrintable(tempDir.errorString()));
+    const QString dirPath = tempDir.path();
+    for (int i = 0; i < 10; ++i) {
+        QFile file(dirPath + u"/file"_s + QString::number(i));
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+    }
+
+    QScopedPointer<MyFriendFileSystemModel> model(new MyFriendFileSystemModel);
+    const QModelIndex root = model->setRootPath(dirPath);
+    QTRY_COMPARE(model->rowCount(root), 10);
+    model->sort(0, order);
+    const QString firstName = order == Qt::AscendingOrder ? u"file0"_s : u"file9"_s;
+    QTRY_COMPARE(model->index(0, 0, root).data().toString(), firstName);
+
+    QSignalSpy removedSpy(model.data(), &QAbstractItemModel::rowsRemoved);
+    QFileSystemModelPrivate *d = model->d_func();
+    d->removeNodes(d->node(root), { u"file0"_s, u"file1"_s, u"file2"_s, u"file3"_s,
+                                    u"file4"_s, u"file8"_s });
+
+    QCOMPARE(removedSpy.size(), expectedRanges.size());
+    for (qsizetype i = 0; i < expectedRanges.size(); ++i) {
+        QCOMPARE(removedSpy.at(i).at(1).toInt(), expectedRanges.at(i).first);
+        QCOMPARE(removedSpy.at(i).at(2).toInt(), expectedRanges.at(i).second);
+    }
+    QStringList names;
+    for (int i = 0; i < model->rowCount(root); ++i)
+        names << model->index(i, 0, root).data().toString();
+    QStringList expected = { u"file5"_s, u"file6"_s, u"file7"_s, u"file9"_s };
+    if (order == Qt::DescendingOrder)
+        std::reverse(expected.begin(), expected.end());
+    QCOMPARE(names, expected);
+}
+#endif
+
 void tst_QFileSystemModel::mkdir()
 {
     QString tmp = flatDirTestPath;
@@ -970,6 +1711,211 @@ void tst_QFileSystemModel::mkdir()
     QCOMPARE(oldRow, idx.row());
 }
 
+void tst_QFileSystemModel::asynchronousDrop_data()
+{
+    QTest::addColumn<Qt::DropAction>("action");
+
+    QTest::newRow("copy") << Qt::CopyAction;
+    QTest::newRow("move") << Qt::MoveAction;
+}
+
+void tst_QFileSystemModel::asynchronousDrop()
+{
+    QFETCH(Qt::DropAction, action);
+
+    QTemporaryDir tempDir;
+    QVERIFY2(tempDir.isValid(), qPrintable(tempDir.errorString()));
+    const QString dirPath = tempDir.path();
+    QDir dir(dirPath);
+    QVERIFY(dir.mkpath(u"source/modules/sub"_s));
+    QVERIFY(dir.mkdir(u"target"_s));
+    const QByteArray contents(100000, 'x');
+    for (const QString &name : {u"source/dialog.tlk"_s, u"source/modules/sub/a.mod"_s}) {
+        QFile file(dirPath + u'/' + name);
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+        QCOMPARE(file.write(contents), contents.size());
+    }
+
+    QFileSystemModel model;
+    model.setReadOnly(false);
+    model.setOption(QFileSystemModel::AsynchronousFileOperations);
+    QVERIFY(model.testOption(QFileSystemModel::AsynchronousFileOperations));
+    const QModelIndex root = model.setRootPath(dirPath);
+    QTRY_COMPARE(model.rowCount(root), 2);
+    const QModelIndex source = model.index(dirPath + u"/source"_s);
+    const QModelIndex target = model.index(dirPath + u"/target"_s);
+    model.fetchMore(source);
+    model.fetchMore(target);
+    QTRY_COMPARE(model.rowCount(source), 2);
+
+    QSignalSpy startedSpy(&model, &QFileSystemModel::fileOperationStarted);
+    QSignalSpy progressSpy(&model, &QFileSystemModel::fileOperationProgress);
+    QSignalSpy finishedSpy(&model, &QFileSystemModel::fileOperationFinished);
+    QMimeData data;
+    data.setUrls({ QUrl::fromLocalFile(dirPath + u"/source/dialog.tlk"_s),
+                   QUrl::fromLocalFile(dirPath + u"/source/modules"_s) });
+    QVERIFY(model.dropMimeData(&data, action, 0, 0, target));
+    QCOMPARE(startedSpy.size(), 1);
+    const int operation = startedSpy.at(0).at(0).toInt();
+
+    QTRY_COMPARE(finishedSpy.size(), 1);
+    QCOMPARE(finishedSpy.at(0).at(0).toInt(), operation);
+    QVERIFY(finishedSpy.at(0).at(1).toBool());
+    QVERIFY(!progressSpy.isEmpty());
+    const QList<QVariant> lastProgress = progressSpy.constLast();
+    QCOMPARE(lastProgress.at(1).toLongLong(), 2 * contents.size());
+    QCOMPARE(lastProgress.at(2).toLongLong(), 2 * contents.size());
+
+    QFile copy(dirPath + u"/target/modules/sub/a.mod"_s);
+    QVERIFY2(copy.open(QIODevice::ReadOnly), qPrintable(copy.errorString()));
+    QCOMPARE(copy.readAll(), contents);
+    QTRY_COMPARE(model.rowCount(target), 2);
+    if (action == Qt::MoveAction) {
+        QVERIFY(!QFileInfo::exists(dirPath + u"/source/dialog.tlk"_s));
+        QCOMPARE(model.rowCount(source), 0);
+    } else {
+        QVERIFY(QFileInfo::exists(dirPath + u"/source/dialog.tlk"_s));
+        QCOMPARE(model.rowCount(source), 2);
+    }
+
+    // existing files are not overwritten
+    QVERIFY(model.dropMimeData(&data, Qt::CopyAction, 0, 0, target));
+    QTRY_COMPARE(finishedSpy.size(), 2);
+    QVERIFY(!finishedSpy.at(1).at(1).toBool());
+}
+
+// Two items of a move have the same target: the one that comes second must
+// fail without removing what the first one moved there
+void tst_QFileSystemModel::asynchronousDropConflict()
+{
+    QTemporaryDir tempDir;
+    QVERIFY2(tempDir.isValid(), qPrintable(tempDir.errorString()));
+    const QString dirPath = tempDir.path();
+    QDir dir(dirPath);
+    for (const QString &name : {u"a"_s, u"b"_s, u"target"_s})
+        QVERIFY(dir.mkdir(name));
+    for (const QString &name : {u"a"_s, u"b"_s}) {
+        QFile file(dirPath + u'/' + name + u"/x"_s);
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+        QCOMPARE(file.write(name.toLatin1()), 1);
+    }
+
+    QFileSystemModel model;
+    model.setReadOnly(false);
+    model.setOption(QFileSystemModel::AsynchronousFileOperations);
+    const QModelIndex root = model.setRootPath(dirPath);
+    QTRY_COMPARE(model.rowCount(root), 3);
+    const QModelIndex target = model.index(dirPath + u"/target"_s);
+
+    QSignalSpy finishedSpy(&model, &QFileSystemModel::fileOperationFinished);
+    QMimeData data;
+    data.setUrls({ QUrl::fromLocalFile(dirPath + u"/a/x"_s),
+                   QUrl::fromLocalFile(dirPath + u"/b/x"_s) });
+    QVERIFY(model.dropMimeData(&data, Qt::MoveAction, 0, 0, target));
+    QTRY_COMPARE(finishedSpy.size(), 1);
+    QVERIFY(!finishedSpy.at(0).at(1).toBool());
+
+    QFile moved(dirPath + u"/target/x"_s);
+    QVERIFY2(moved.open(QIODevice::ReadOnly), qPrintable(moved.errorString()));
+    const QByteArray contents = moved.readAll();
+    QVERIFY(contents == "a" || contents == "b");
+    // the source that was not moved is still there
+    const QString other = contents == "a" ? u"/b/x"_s : u"/a/x"_s;
+    QVERIFY(QFileInfo::exists(dirPath + other));
+    QVERIFY(!QFileInfo::exists(dirPath + u'/' + QString::fromLatin1(contents) + u"/x"_s));
+
+    // a directory is never copied or moved into itself
+    const QModelIndex a = model.index(dirPath + u"/a"_s);
+    QVERIFY(QDir(dirPath).mkdir(u"a/sub"_s));
+    QMimeData self;
+    self.setUrls({ QUrl::fromLocalFile(dirPath + u"/a"_s) });
+    QVERIFY(!model.dropMimeData(&self, Qt::CopyAction, 0, 0, a));
+    QVERIFY(!model.dropMimeData(&self, Qt::MoveAction, 0, 0,
+                                model.index(dirPath + u"/a/sub"_s)));
+    QVERIFY(!QFileInfo::exists(dirPath + u"/a/a"_s));
+    QVERIFY(!QFileInfo::exists(dirPath + u"/a/sub/a"_s));
+    QCOMPARE(finishedSpy.size(), 1);
+}
+
+void tst_QFileSystemModel::asynchronousRemove()
+{
+    QTemporaryDir tempDir;
+    QVERIFY2(tempDir.isValid(), qPrintable(tempDir.errorString()));
+    const QString dirPath = tempDir.path();
+    QVERIFY(QDir(dirPath).mkpath(u"modules/sub"_s));
+    const int fileCount = 1200;
+    for (int i = 0; i < fileCount; ++i) {
+        QFile file(dirPath + u"/modules/file"_s + QString::number(i));
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+        QCOMPARE(file.write("data"), 4);
+    }
+    {
+        QFile file(dirPath + u"/modules/sub/a.mod"_s);
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+    }
+
+    QFileSystemModel model;
+    model.setReadOnly(false);
+    model.setOption(QFileSystemModel::AsynchronousFileOperations);
+    const QModelIndex root = model.setRootPath(dirPath);
+    QTRY_COMPARE(model.rowCount(root), 1);
+    const QPersistentModelIndex modules = model.index(dirPath + u"/modules"_s);
+    model.fetchMore(modules);
+    QTRY_COMPARE(model.rowCount(modules), fileCount + 1);
+
+    QSignalSpy startedSpy(&model, &QFileSystemModel::fileOperationStarted);
+    QSignalSpy progressSpy(&model, &QFileSystemModel::fileOperationProgress);
+    QSignalSpy finishedSpy(&model, &QFileSystemModel::fileOperationFinished);
+    QSignalSpy rowsRemovedSpy(&model, &QAbstractItemModel::rowsRemoved);
+    QVERIFY(model.remove(modules));
+    QCOMPARE(startedSpy.size(), 1);
+    QTRY_COMPARE(finishedSpy.size(), 1);
+    QVERIFY(finishedSpy.at(0).at(1).toBool());
+    QCOMPARE(progressSpy.constLast().at(1).toLongLong(), 4 * fileCount);
+    QCOMPARE(progressSpy.constLast().at(2).toLongLong(), 4 * fileCount);
+
+    // the files were removed from the model in batches, then the directory
+    QVERIFY(!QFileInfo::exists(dirPath + u"/modules"_s));
+    QVERIFY(!modules.isValid());
+    QCOMPARE(model.rowCount(root), 0);
+    QVERIFY(rowsRemovedSpy.size() > 2);
+}
+
+#ifdef QT_BUILD_INTERNAL
+// Finishing an item doesn't load the directories it touched into the model
+void tst_QFileSystemModel::fileOperationsOnUnloadedDirectories()
+{
+    QTemporaryDir tempDir;
+    QVERIFY2(tempDir.isValid(), qPrintable(tempDir.errorString()));
+    const QString dirPath = tempDir.path();
+    QVERIFY(QDir(dirPath).mkpath(u"outside/deep"_s));
+    QVERIFY(QDir(dirPath).mkdir(u"target"_s));
+    {
+        QFile file(dirPath + u"/outside/deep/x"_s);
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+    }
+
+    MyFriendFileSystemModel model;
+    model.setReadOnly(false);
+    model.setOption(QFileSystemModel::AsynchronousFileOperations);
+    const QModelIndex root = model.setRootPath(dirPath);
+    QTRY_COMPARE(model.rowCount(root), 2);
+    const QModelIndex outside = model.index(dirPath + u"/outside"_s);
+    const QModelIndex target = model.index(dirPath + u"/target"_s);
+
+    QSignalSpy finishedSpy(&model, &QFileSystemModel::fileOperationFinished);
+    QMimeData data;
+    data.setUrls({ QUrl::fromLocalFile(dirPath + u"/outside/deep/x"_s) });
+    QVERIFY(model.dropMimeData(&data, Qt::MoveAction, 0, 0, target));
+    QTRY_COMPARE(finishedSpy.size(), 1);
+    QVERIFY(finishedSpy.at(0).at(1).toBool());
+    QVERIFY(QFileInfo::exists(dirPath + u"/target/x"_s));
+
+    QCOMPARE(model.d_func()->loadedNode(dirPath + u"/outside/deep"_s), nullptr);
+    QVERIFY(model.d_func()->node(outside)->children.isEmpty());
+}
+#endif
+
 void tst_QFileSystemModel::deleteFile()
 {
     QString newFilePath = QDir::temp().filePath("NewFileDeleteTest");
@@ -1079,6 +2025,74 @@ void tst_QFileSystemModel::caseSensitivity()
     }
 }
 
+void tst_QFileSystemModel::caseInsensitiveNames()
+{
+    QTemporaryDir tempDir;
+    QVERIFY2(tempDir.isValid(), qPrintable(tempDir.errorString()));
+    const QString dirPath = tempDir.path();
+    QVERIFY(QDir(dirPath).mkdir(u"Override"_s));
+    {
+        QFile file(dirPath + u"/Override/TEXTURES.tpc"_s);
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+    }
+
+    QFileSystemModel model;
+    model.setOption(QFileSystemModel::CaseInsensitiveNames);
+#if defined(Q_OS_WIN)
+    QVERIFY(!model.testOption(QFileSystemModel::CaseInsensitiveNames));
+#else
+    QVERIFY(model.testOption(QFileSystemModel::CaseInsensitiveNames));
+#endif
+    const QModelIndex root = model.setRootPath(dirPath);
+    QTRY_COMPARE(model.rowCount(root), 1);
+    const QModelIndex override = model.index(dirPath + u"/Override"_s);
+    model.fetchMore(override);
+    QTRY_COMPARE(model.rowCount(override), 1);
+
+    QCOMPARE(model.index(dirPath + u"/override"_s), override);
+    const QModelIndex texture = model.index(dirPath + u"/override/textures.tpc"_s);
+    QVERIFY(texture.isValid());
+    QCOMPARE(texture.parent(), override);
+    QCOMPARE(model.fileName(texture), u"TEXTURES.tpc"_s);
+    QCOMPARE(model.filePath(texture), dirPath + u"/Override/TEXTURES.tpc"_s);
+
+    // on case sensitive file systems, files whose names only differ in case
+    // all stay in the model, and exact names find their own file
+    if (!QDir(dirPath).mkdir(u"override"_s))
+        return;
+    QTRY_COMPARE(model.rowCount(root), 2);
+    const QModelIndex lower = model.index(dirPath + u"/override"_s);
+    QVERIFY(lower.isValid());
+    QVERIFY(lower != override);
+    QCOMPARE(model.fileName(lower), u"override"_s);
+    QCOMPARE(model.index(dirPath + u"/Override"_s), override);
+    QVERIFY(model.index(dirPath + u"/OVERRIDE"_s).isValid());
+
+    model.setOption(QFileSystemModel::CaseInsensitiveNames, false);
+    QCOMPARE(model.rowCount(root), 2);
+    QVERIFY(!model.index(dirPath + u"/OVERRIDE"_s).isValid());
+    model.setOption(QFileSystemModel::CaseInsensitiveNames);
+    QCOMPARE(model.rowCount(root), 2);
+    QCOMPARE(model.rowCount(override), 1);
+}
+
+#ifdef QT_BUILD_INTERNAL
+// The hash of a key is the one of its case folded name, and depends on the seed
+void tst_QFileSystemModel::nodePathKeyHash()
+{
+    // longer than a chunk of hashFolded()
+    const QString name = u"Override/"_s.repeated(10) + u"C_Droid\U0001D400.TPC"_s;
+    const QFileSystemModelNodePathKey key(name, true);
+    const QFileSystemModelNodePathKey folded(name.toCaseFolded(), true);
+    QCOMPARE(key, folded);
+    for (size_t seed : { size_t(0), size_t(1), QHashSeed::globalSeed() })
+        QCOMPARE(qHash(key, seed), qHash(folded, seed));
+    QCOMPARE(qHash(key, QHashSeed::globalSeed()),
+             QFileSystemModelNodePathKey::hashFolded(name, QHashSeed::globalSeed()));
+    QVERIFY(qHash(key, 1) != qHash(key, 2));
+}
+#endif
+
 void tst_QFileSystemModel::drives_data()
 {
     QTest::addColumn<QString>("path");
@@ -1175,6 +2189,98 @@ static inline QByteArray permissionRowName(bool readOnly, int permission)
     return result;
 }
 
+void tst_QFileSystemModel::multiData()
+{
+    QTemporaryDir tempDir;
+    QVERIFY2(tempDir.isValid(), qPrintable(tempDir.errorString()));
+    const QString dirPath = tempDir.path();
+    {
+        QFile file(dirPath + u"/file.txt"_s);
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+        QCOMPARE(file.write("data"), 4);
+    }
+
+    QFileSystemModel model;
+    const QModelIndex root = model.setRootPath(dirPath);
+    QTRY_COMPARE(model.rowCount(root), 1);
+    const QModelIndex file = model.index(dirPath + u"/file.txt"_s);
+    const int roles[] = {
+        Qt::DisplayRole, Qt::EditRole, Qt::TextAlignmentRole, Qt::ToolTipRole,
+        QFileSystemModel::FilePathRole, QFileSystemModel::FileNameRole,
+        QFileSystemModel::FilePermissions
+    };
+
+    for (int column = 0; column < model.columnCount(root); ++column) {
+        const QModelIndex index = file.siblingAtColumn(column);
+        std::vector<QModelRoleData> roleData;
+        for (int role : roles)
+            roleData.emplace_back(role);
+        model.multiData(index, roleData);
+        for (const QModelRoleData &data : roleData)
+            QCOMPARE(data.data(), index.data(data.role()));
+    }
+
+    QModelRoleData invalid(Qt::DisplayRole);
+    invalid.setData(u"stale"_s);
+    model.multiData(QModelIndex(), invalid);
+    QVERIFY(!invalid.data().isValid());
+}
+
+void tst_QFileSystemModel::mimeData()
+{
+    QTemporaryDir tempDir;
+    QVERIFY2(tempDir.isValid(), qPrintable(tempDir.errorString()));
+    const QString dirPath = tempDir.path();
+    const QStringList names = { u"a.mod"_s, u"b c.tlk"_s, u"d.2da"_s };
+    for (const QString &name : names) {
+        QFile file(dirPath + u'/' + name);
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(file.errorString()));
+    }
+
+    auto model = std::make_unique<MyFriendFileSystemModel>();
+    model->setReadOnly(false);
+    const QModelIndex root = model->setRootPath(dirPath);
+    QTRY_COMPARE(model->rowCount(root), names.size());
+
+    QModelIndexList indexes;
+    QList<QUrl> expected;
+    for (const QString &name : names) {
+        const QModelIndex index = model->index(dirPath + u'/' + name);
+        indexes << index << index.siblingAtColumn(1);
+        expected << QUrl::fromLocalFile(dirPath + u'/' + name);
+    }
+    QByteArray expectedUriList;
+    for (const QUrl &url : std::as_const(expected))
+        expectedUriList += url.toEncoded() + "\r\n";
+
+    std::unique_ptr<QMimeData> data(model->mimeData(indexes));
+    QVERIFY(data);
+    QVERIFY(data->hasUrls());
+    QVERIFY(data->formats().contains(u"text/uri-list"_s));
+    QCOMPARE(data->urls(), expected);
+    QCOMPARE(data->data(u"text/uri-list"_s), expectedUriList);
+
+    // the dragged items keep their paths when their nodes are deleted...
+    std::unique_ptr<QMimeData> removed(model->mimeData(indexes));
+    std::unique_ptr<QMimeData> untouched(model->mimeData({ model->index(dirPath + u"/a.mod"_s) }));
+    QVERIFY(model->remove(model->index(dirPath + u"/b c.tlk"_s)));
+    QTRY_COMPARE(model->rowCount(root), names.size() - 1);
+    QCOMPARE(removed->urls(), expected);
+#ifdef QT_BUILD_INTERNAL
+    // only the ones that referred to a deleted node stopped referring to nodes
+    const QList<QFileSystemModelMimeData *> &lazyMimeData = model->d_func()->lazyMimeData;
+    QVERIFY(!lazyMimeData.contains(static_cast<QFileSystemModelMimeData *>(removed.get())));
+    QVERIFY(lazyMimeData.contains(static_cast<QFileSystemModelMimeData *>(untouched.get())));
+#endif
+    QCOMPARE(untouched->urls(), QList<QUrl>{ expected.at(0) });
+
+    // ...and when the model is destroyed
+    std::unique_ptr<QMimeData> orphaned(model->mimeData({ model->index(dirPath + u"/d.2da"_s) }));
+    model.reset();
+    QCOMPARE(orphaned->urls(), QList<QUrl>{ expected.at(2) });
+    QCOMPARE(orphaned->data(u"text/uri-list"_s), expected.at(2).toEncoded() + "\r\n");
+}
+
 void tst_QFileSystemModel::permissions_data()
 {
     QTest::addColumn<QFileDevice::Permissions>("permissions");